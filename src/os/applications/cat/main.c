@@ -102,7 +102,9 @@ static void free_file_list(void)
 	file_list_t* current_entry = file_list_pop();
 	do
 	{
-		fclose(current_entry->file);
+		//stdin belongs to the shell
+		if(current_entry->file != stdin)
+			fclose(current_entry->file);
 		free(current_entry);
 	} while ((current_entry = file_list_pop()));
 }
@@ -205,7 +207,8 @@ int main(int argc, char* argv[])
 	do
 	{
 		returnCode = handle_file(current_entry->file);
-		fclose(current_entry->file);
+		if(current_entry->file != stdin)
+			fclose(current_entry->file);
 		free(current_entry);
 		if(returnCode != 0)
 		{
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../include/hal/pit.h"
+//------------------------------------------------------------------------------------------
+//				Consts
+//------------------------------------------------------------------------------------------
+#define FLAG_BENCHMARK 0x00000001
+
+#define NAIVE_CHUNK BUFSIZ //Chunk size of the fread/fwrite loop the benchmark compares against
+
+//------------------------------------------------------------------------------------------
+//				Local Vars
+//------------------------------------------------------------------------------------------
+static uint32_t flags = 0;
+
+static char* source = NULL;
+static char* destination = NULL;
+
+//------------------------------------------------------------------------------------------
+//				Private Function
+//------------------------------------------------------------------------------------------
+static int parse_arguments(int argc, char* argv[])
+{
+	for(int i = 0; i < argc; i++)
+	{
+		//this is a path
+		if(argv[i][0] != '-')
+		{
+			if(!source)
+				source = argv[i];
+			else if(!destination)
+				destination = argv[i];
+			else
+			{
+				//Too many paths
+				errno = EINVAL;
+				return -1;
+			}
+		}
+		else
+		{
+			size_t flag_count = strlen(argv[i]) - 1;
+			for(; flag_count > 0; flag_count --)
+			{
+				char flag = argv[i][flag_count];
+				if(flag == 'b')
+				{
+					flags |= FLAG_BENCHMARK;
+				}
+				else
+				{
+					//UNDEFINED FLAG
+				}
+			}
+		}
+	}
+
+	if(!source || !destination)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+//Opens the destination as an empty file
+static FILE* open_destination(void)
+{
+	//"w" doesn't truncate, so an old file has to be removed first.
+	//The source is already open, so a destination naming the same file can't be removed
+	remove(destination);
+
+	return fopen(destination, "w");
+}
+
+//Copies inside the kernel
+static size_t copy_kernel(FILE* in, FILE* out, size_t length)
+{
+	return copy_file_range(in, out, length);
+}
+
+//Copies through a user buffer
+static size_t copy_naive(FILE* in, FILE* out, size_t length)
+{
+	char buffer[NAIVE_CHUNK];
+	size_t copied = 0;
+
+	while(copied < length)
+	{
+		size_t read = fread(buffer, sizeof(char), NAIVE_CHUNK, in);
+		size_t written = fwrite(buffer, sizeof(char), read, out);
+		copied += written;
+
+		if(written < read || read < NAIVE_CHUNK)
+			break;
+	}
+
+	return copied;
+}
+
+//Copies the source and reports how long it took
+static int run_copy(const char* name, size_t (*copy)(FILE*, FILE*, size_t))
+{
+	FILE* in = fopen(source, "r");
+	if(!in)
+	{
+		perror(source);
+		return -1;
+	}
+
+	FILE* out = open_destination();
+	if(!out)
+	{
+		perror(destination);
+		fclose(in);
+		return -1;
+	}
+
+	size_t length = in->file_desc->length;
+
+	uint32_t start = getTicks();
+	size_t copied = copy(in, out, length);
+	fclose(out); //Includes writing the cached data back
+	uint32_t ticks = getTicks() - start;
+
+	fclose(in);
+
+	if(copied < length)
+	{
+		fprintf(stderr, "cp: %s: copied %u of %u bytes\n", destination, copied, length);
+		return -1;
+	}
+
+	if(flags & FLAG_BENCHMARK)
+	{
+		//The PIT ticks every millisecond
+		printf("%s: %u bytes in %u ms", name, length, ticks);
+		if(ticks > 0)
+			printf(" (%u KiB/s)", (uint32_t)((uint64_t)length * 1000 / 1024 / ticks));
+		printf("\n");
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+//Usage: cp [-b] <source> <destination>
+//-b copies a second time through a fread/fwrite loop and prints the time of both copies
+int main(int argc, char* argv[])
+{
+	if(parse_arguments(argc - 1, &argv[1]) != 0)
+	{
+		perror("cp");
+		return -1;
+	}
+
+	if(flags & FLAG_BENCHMARK)
+	{
+		if(run_copy("fread/fwrite", copy_naive) != 0)
+			return -1;
+	}
+
+	return run_copy("copy_file_range", copy_kernel);
+}
@@ -53,9 +53,18 @@ int test(void* arg) {
 }
 int writeFile(void* arg) {
 	fseek(file, 0, SEEK_SET);
+	// Rows and their line breaks get written in batches
+	iovec iov[64];
+	int count = 0;
 	for (int i = 0; i < numrows; i++) {
-		fwrite((void*)rows[i].chars, sizeof(char), rows[i].len, file);
-		fwrite((void*)"\n", sizeof(char), 1, file);
+		iov[count].iov_base = (void*)rows[i].chars;
+		iov[count++].iov_len = rows[i].len;
+		iov[count].iov_base = (void*)"\n";
+		iov[count++].iov_len = 1;
+		if (count == 64 || i == numrows - 1) {
+			writev(file, iov, count);
+			count = 0;
+		}
 	}
 	return 0;
 }
@@ -128,6 +128,7 @@ typedef union status_t
 
 // Holds information about drives
 static drive_t drives[ATA_MAX_DRIVES];
+static ata_stats_t stats[ATA_MAX_DRIVES];
 
 // Save current and last used drive to reduce unnecessary I/O instructions
 static uint8_t current = ATA_MAX_DRIVES;
@@ -456,6 +457,17 @@ static int doDataTansfer(void* buf, uint64_t lba, uint32_t sectors, uint8_t driv
 	// Round up to full PIO transfers and divide by transfer size
 	uint32_t count = ((sectors + divisor - 1) & -divisor) / divisor;
 	
+	if (mode == READ_MODE)
+	{
+		stats[drive].reads++;
+		stats[drive].sectorsRead += sectors;
+	}
+	else
+	{
+		stats[drive].writes++;
+		stats[drive].sectorsWritten += sectors;
+	}
+
 	// Do the needed number of PIO transfers
 	for (uint32_t i = 0; i < count; i++)
 	{
@@ -464,7 +476,8 @@ static int doDataTansfer(void* buf, uint64_t lba, uint32_t sectors, uint8_t driv
 		uint16_t *bufOffset = (uint16_t*)((uintptr_t)buf + i * divisor * NUM_WORDS);
 		uint64_t lbaOffset = lba + i * divisor;
 
-		doPIOTransfer(bufOffset, bus(drive), drv(drive), lbaOffset, amount, useLBA48, mode);
+		if (doPIOTransfer(bufOffset, bus(drive), drv(drive), lbaOffset, amount, useLBA48, mode))
+			stats[drive].errors++;
 	}
 
 	return 0;
@@ -510,3 +523,15 @@ drive_t getDrive(uint8_t drive)
 
 	return drives[drive];
 }
+
+// Gets the I/O counters of a drive
+void ataGetStats(uint8_t drive, ata_stats_t *out)
+{
+	if (drive >= ATA_MAX_DRIVES) // Return "zero" struct on error
+	{
+		*out = (const ata_stats_t){ 0, 0, 0, 0, 0 };
+		return;
+	}
+
+	*out = stats[drive];
+}
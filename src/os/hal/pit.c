@@ -11,12 +11,15 @@ static pit_subhandler_t subhandlers[MAX_SUBHANDLER];
 static uint32_t subhandler_counter[MAX_SUBHANDLER];
 static uint32_t subhandler_current_counter[MAX_SUBHANDLER];
 static size_t subhandler_count;
+static volatile uint32_t ticks; //Milliseconds since initPIT
 
 //------------------------------------------------------------------------------------------
 //				Interrupt Handler
 //------------------------------------------------------------------------------------------
 __interrupt_handler static void pit_handler(InterruptFrame_t* frame)
 {
+	ticks++;
+
 	//Test every subhandler
 	for(size_t i = 0; i < subhandler_count; i++)
 	{
@@ -112,6 +115,11 @@ int remSubhandler(pit_subhandler_t subhandler)
 	return 0;
 }
 
+uint32_t getTicks(void)
+{
+	return ticks;
+}
+
 void speakerPlay(uint32_t frequency)
 {
 	// Configure PIT timer 2
@@ -12,6 +12,7 @@
 //------------------------------------------------------------------------------------------
 //				Constants
 //------------------------------------------------------------------------------------------
+#define ELF_HEAD_SIZE 4096	//Bytes at the start of the file read at once, they hold the headers
 
 //------------------------------------------------------------------------------------------
 //				Types
@@ -32,6 +33,10 @@ typedef struct
 {
 	FILE* file;
 
+	//Start of the file, the headers are parsed from it
+	char* head;
+	size_t head_size;
+
 	ELF_header_t* header_cache;
 	ELF_program_header_info_t* program_header_info_cache;
 	ELF_section_header_info_t* section_header_info_cache;
@@ -48,6 +53,8 @@ bool is_elf_valid(ELF_FILE* file);											//Checks for magic numbers
 ELF_header_t* get_elf_header(ELF_FILE* file);							//Get reference to ELF header struct in file
 ELF_program_header_info_t* get_elf_program_header_info(ELF_FILE* file);	//Get info struct of the elf program header of the file
 ELF_section_header_info_t* get_elf_section_header_info(ELF_FILE* file);	//Get info struct of the elf section header of the file
+size_t read_elf_file(ELF_FILE* file, size_t offset, size_t size, void* buffer);	//Reads a part of the file, from memory if possible
+void free_elf_head(ELF_FILE* file);										//Frees the start of the file once the headers are parsed
 
 void dispose_elf_file_struct(ELF_FILE* file);							//Releases all ELF_FILE related memory
 ELF_FILE* create_elf_file_struct(FILE* file);							//Creates a ELF_FILE struct out of a FILE struct
@@ -33,6 +33,12 @@
 #define DST_DEBUG		21
 #define DST_TEXTREL		22
 #define DST_JMPREL		23
+#define DST_BIND_NOW	24
+#define DST_FLAGS		30
+#define DST_GNU_HASH	0x6ffffef5
+
+//Flags of the DST_FLAGS entry
+#define DF_BIND_NOW		0x08
 
 //------------------------------------------------------------------------------------------
 //				Types
@@ -45,6 +45,12 @@
 #define PHT_NOTE		4
 #define PHT_SHLIB		5
 #define PHT_PHDR		6
+#define PHT_GNU_STACK	0x6474e551
+#define PHT_GNU_RELRO	0x6474e552
+
+#define PHF_EXEC		0x01
+#define PHF_WRITE		0x02
+#define PHF_READ		0x04
 
 
 #define SHT_NULL		0
@@ -59,6 +65,7 @@
 #define SHT_REL			9
 #define SHT_SHLIB		10
 #define SHT_DYNSYM		11
+#define SHT_GNU_HASH	0x6ffffff6
 
 #define SHF_WRITE		0x01
 #define SHF_ALLOC		0x02
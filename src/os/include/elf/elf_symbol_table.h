@@ -23,6 +23,8 @@
 #define STET_SECTION		3
 #define STET_FILE			4
 
+#define SHN_UNDEF			0
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
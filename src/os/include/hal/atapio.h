@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 //------------------------------------------------------------------------------------------
 //				Constants
@@ -38,6 +39,16 @@ typedef struct drive_t
 	uint8_t type;
 } drive_t;
 
+// I/O counters of a drive since boot
+typedef struct ata_stats_t
+{
+	size_t reads;          // Read requests
+	size_t writes;         // Write requests
+	size_t sectorsRead;
+	size_t sectorsWritten;
+	size_t errors;         // Failed PIO transfers
+} ata_stats_t;
+
 //------------------------------------------------------------------------------------------
 //				Variables
 //------------------------------------------------------------------------------------------
@@ -52,5 +63,6 @@ int ataRead(void* buf, uint64_t lba, uint32_t sectors, uint8_t drive);
 int ataWrite(void* buf, uint64_t lba, uint32_t sectors, uint8_t drive);
 
 drive_t getDrive(uint8_t drive);
+void ataGetStats(uint8_t drive, ata_stats_t *stats);
 
 #endif // _ATAPIO_H
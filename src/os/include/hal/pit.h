@@ -58,6 +58,8 @@ int initPIT(void);
 int addSubhandler(pit_subhandler_t,uint32_t);
 int remSubhandler(pit_subhandler_t);
 
+uint32_t getTicks(void);
+
 void speakerPlay(uint32_t frequency);
 void speakerStop();
 
@@ -13,6 +13,11 @@
 //------------------------------------------------------------------------------------------
 #define MAX_LOADED_LIBS	10
 
+//Static executables are linked for this memory (STATIC_APP_LFLAGS in src/os/Makefile)
+//A static executable claims the part it needs from the PMM while it runs
+#define LINKER_STATIC_BASE	0x01000000
+#define LINKER_STATIC_SIZE	0x01000000
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
@@ -45,9 +50,13 @@ typedef struct
 typedef struct
 {
 	//Basic information about the library
-	ELF_FILE* file;
+	const char* name;
+	ELF_FILE* file;	//NULL for the kernel, resident libraries and cached executable images
 	void* base_address;
 	size_t page_count;
+	bool resident;	//Kept in memory for the following programs
+	void* entry_point;	//Load time address of the entry, executables only
+	void* fixed_address;	//Start of the memory of an executable linked for fixed addresses
 
 	//Dependancies of the library
 	char* libs[MAX_LOADED_LIBS];
@@ -58,7 +67,10 @@ typedef struct
 	size_t string_table_size;
 	ELF_symbol_table_entry_t* symbol_table_base;
 	size_t symbol_table_entry_size;
+	size_t symbol_count;	//Counted once when the library is loaded
+	//At least one hash table has to be present, the GNU one is preferred
 	void* hash_table_base;
+	void* gnu_hash_table_base;
 
 	//Optimal dynamic section entries
 	dynamic_linker_needed_type_t* last_needed_entry;
@@ -69,6 +81,17 @@ typedef struct
 
 	dynamic_linker_dynamic_symbol_t* last_dynamic_entry;
 } libinfo_t;
+//Launch counters of the linker
+typedef struct
+{
+	size_t cold_launches;	//Programs loaded from their file
+	size_t warm_launches;	//Programs started from a cached image
+	size_t static_launches;	//Programs started without the dynamic linker
+	uint32_t cold_ticks;	//Milliseconds spent until the programs started
+	uint32_t warm_ticks;
+	uint32_t static_ticks;
+	size_t images;			//Executable images currently cached
+} linker_stats_t;
 
 //------------------------------------------------------------------------------------------
 //				Macros
@@ -77,13 +100,12 @@ typedef struct
 //Resolves a compile time address to the load time address
 #define RESOLVE_MEM_ADDRESS(i,a) (i->base_address + a)
 //Get the char* to the library name
-#define LIBINFO_NAME(i) i->file->file->file_desc->name
+#define LIBINFO_NAME(i) i->name
 //Load a part of a lib into buffer_pointer.
 //Gets buffer from the heap
 #define READ_FROM_DISK(libinfo, buffer_pointer, offset, size) \
 		buffer_pointer = kmalloc(size); \
-		vfsSeek(libinfo->file->file, offset, SEEK_SET); \
-		vfsRead(libinfo->file->file, (void*)buffer_pointer, size);
+		read_elf_file(libinfo->file, offset, size, (void*)buffer_pointer);
 //Frees the space of a libinfo pointer
 #define LIBINFO_FREE(i) \
 		dispose_elf_file_struct(i->file); \
@@ -96,6 +118,9 @@ typedef struct
 extern libinfo_t* loaded_libs[MAX_LOADED_LIBS];
 extern size_t loaded_lib_count;
 
+//Resolve every PLT slot before the program starts instead of on its first call
+extern bool linker_eager_binding;
+
 //The dynamic linked shell streams
 extern FILE* stdout;
 extern FILE* stdin;
@@ -109,5 +134,9 @@ extern FILE* stderr;
 int linker_main(FILE* in_stream, FILE* out_stream, FILE* err_stream, FILE* executable, int argc, char *argv[]);
 //Processes the program header of a library
 int process_program_header(libinfo_t* libinfo);
+//Frees a library and the memory it was loaded into
+void linker_free_lib(libinfo_t* libinfo);
+//Gets the launch counters
+void linker_get_stats(linker_stats_t* stats);
 
 #endif
@@ -0,0 +1,75 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define ARENA_CLASS_COUNT 8 // Size classes from 16 to 2048 bytes
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Header at the beginning of every set of continuous blocks owned by an arena
+typedef struct arena_run_t
+{
+	struct arena_run_t *next;
+	size_t blocks; // The amount of memory blocks this run spans
+} arena_run_t;
+
+// Allocator for the memory of one program.
+// Memory is bumped out of PMM blocks and recycled through size class freelists.
+// All of it is released at once when the arena gets destroyed.
+typedef struct arena_t
+{
+	arena_run_t *runs; // All runs owned by this arena
+
+	uintptr_t bumpPtr; // Next free address in the current run
+	uintptr_t bumpEnd; // End of the current run
+
+	void *freeLists[ARENA_CLASS_COUNT]; // Freed blocks sorted by size class
+
+	size_t reallocCopied; // Bytes realloc had to copy
+	size_t reallocSaved;  // Bytes realloc did not copy because it grew in place
+} arena_t;
+
+// Totals of the arenas of all finished programs
+typedef struct arena_stats_t
+{
+	size_t destroyed;      // Arenas destroyed so far
+	size_t releasedBlocks; // Blocks they gave back to the PMM
+	size_t reallocCopied;
+	size_t reallocSaved;
+} arena_stats_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+// The arena of the currently running program (NULL while the shell runs)
+extern arena_t *currentArena;
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+arena_t* arenaCreate();
+void arenaDestroy(arena_t *arena);
+
+void* arenaAlloc(arena_t *arena, size_t size);
+void* arenaRealloc(arena_t *arena, void *ptr, size_t size);
+int arenaFree(arena_t *arena, void *ptr);
+
+int arenaOwns(arena_t *arena, const void *ptr);
+
+void arenaGetStats(arena_stats_t *out);
+
+#endif // _ARENA_H
@@ -12,10 +12,65 @@
 //				Constants
 //------------------------------------------------------------------------------------------
 
+#define HEAP_HISTOGRAM_SIZE 12 // Power of two size buckets from <=16 bytes to >16KiB
+#define HEAP_MAX_CALLERS    32 // Allocation sites tracked by the profiler
+
+// Operations reported to the trace hook
+#define HEAP_TRACE_ALLOC   'a' // kmalloc and friends
+#define HEAP_TRACE_ZALLOC  'z' // kzalloc and kcalloc
+#define HEAP_TRACE_REALLOC 'r' // krealloc, old holds the original pointer
+#define HEAP_TRACE_FREE    'f' // kfree
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
 
+// Receives heap operations for recording allocation traces
+typedef void (*heap_trace_hook_t)(char op, uintptr_t ptr, size_t size, uintptr_t old);
+
+// Global counters of the heap
+typedef struct heap_stats_t
+{
+	size_t liveBytes;   // Bytes currently handed out
+	size_t liveObjects; // Allocations currently handed out
+	size_t peakBytes;   // Maximum of liveBytes since boot
+
+	size_t allocations; // Successful allocations since boot
+	size_t frees;       // Frees since boot
+	size_t failed;      // Allocations that ran out of memory
+
+	size_t histogram[HEAP_HISTOGRAM_SIZE]; // Allocation count by size bucket
+
+	size_t reallocCopied; // Bytes krealloc had to copy
+	size_t reallocSaved;  // Bytes krealloc did not copy because it resized in place
+
+	// The following fields are calculated by walking the heap
+	size_t chunks;        // Number of chunks
+	size_t chunkBytes;    // Bytes of all chunks together
+	size_t freeBytes;     // Bytes inside chunks not used by allocations or headers
+	size_t largestFree;   // Largest free gap over all chunks
+	uint32_t fragmentation; // Percentage of free bytes not inside the largest gap
+} heap_stats_t;
+
+// Utilisation of a single chunk
+typedef struct heap_chunk_info_t
+{
+	uintptr_t address;
+	size_t blocks;      // Memory blocks the chunk spans
+	size_t allocations; // Number of allocations inside the chunk
+	size_t usedBytes;   // Bytes used by allocations including their headers
+	size_t largestFree; // Largest free gap inside the chunk
+} heap_chunk_info_t;
+
+// Allocation statistics of one call site
+typedef struct heap_caller_t
+{
+	uintptr_t caller;    // Return address into the allocating function (0 collects overflow)
+	size_t allocations;  // Allocations done since boot
+	size_t liveObjects;  // Allocations currently alive
+	size_t liveBytes;    // Bytes currently alive
+} heap_caller_t;
+
 //------------------------------------------------------------------------------------------
 //				Variables
 //------------------------------------------------------------------------------------------
@@ -38,4 +93,10 @@ void* kmemdup(const void *src, size_t len);
 
 void kfree(const void *objp);
 
+void heapSetTraceHook(heap_trace_hook_t hook);
+
+void heapGetStats(heap_stats_t *stats);
+size_t heapGetChunks(heap_chunk_info_t *chunks, size_t max);
+size_t heapGetCallers(heap_caller_t *callers, size_t max);
+
 #endif // _HEAP_H
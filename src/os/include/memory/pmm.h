@@ -16,10 +16,27 @@
 // Block size publicy declared for use in heap allocator
 #define PMM_BLOCK_SIZE 4096
 
+// Number of free blocks kept zeroed for zeroed allocations
+#define PMM_ZERO_POOL_SIZE 256
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
 
+// Block usage of the physical memory
+typedef struct pmm_stats_t
+{
+	size_t totalBlocks;
+	size_t usedBlocks;
+	size_t peakUsedBlocks;
+	size_t largestFreeRun; // Longest run of continuous free blocks
+	size_t zeroedBlocks;   // Free blocks already zeroed
+} pmm_stats_t;
+
+// Gives memory back when an allocation can't be served, for example cached file pages
+// Returns the number of blocks freed
+typedef size_t (*pmm_reclaim_t)(size_t blocks);
+
 //------------------------------------------------------------------------------------------
 //				Variables
 //------------------------------------------------------------------------------------------
@@ -39,4 +56,11 @@ void pmmFree(void* ptr);
 void* pmmAllocContinuous(size_t size);
 void pmmFreeContinuous(void* ptr, size_t size);
 
+void* pmmAllocContinuousZeroed(size_t size);
+size_t pmmZeroIdle(size_t count);
+
+void pmmSetReclaim(pmm_reclaim_t reclaim);
+
+void pmmGetStats(pmm_stats_t *stats);
+
 #endif // _PMM_H
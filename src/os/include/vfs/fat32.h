@@ -28,8 +28,11 @@
 
 size_t readFAT32(file_desc_t *node, size_t offset, size_t size, char *buf);
 size_t writeFAT32(file_desc_t *node, size_t offset, size_t size, char *buf);
+size_t readvFAT32(file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt);
+size_t writevFAT32(file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt);
+int reserveFAT32(file_desc_t *node, size_t size);
 int readdirFAT32(DIR *dirstream);
-file_desc_t *findfileFAT32(file_desc_t *node, char *name);
+file_desc_t *findfileFAT32(file_desc_t *node, char *name, bool *missing);
 int mkfileFAT32(file_desc_t *file);
 int rmfileFAT32(file_desc_t *file);
 int renameFAT32(file_desc_t *file, file_desc_t *newParent, char *origName);
@@ -0,0 +1,50 @@
+#ifndef _PAGECACHE_H
+#define _PAGECACHE_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <vfs/vfs.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define PAGECACHE_MAX_PAGES 256 // Pages kept before the least recently used get evicted
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Counters of the page cache
+typedef struct pagecache_stats_t
+{
+	size_t pages;      // Pages currently cached
+	size_t dirtyPages; // Pages with data not yet written to the filesystem
+	size_t hits;       // Page lookups served from memory
+	size_t misses;     // Page lookups that had to read from the filesystem
+	size_t reads;      // Filesystem reads issued for missing pages (runs of them are read at once)
+	size_t evictions;  // Pages dropped to make room
+	size_t writebacks; // Dirty pages written to the filesystem
+} pagecache_stats_t;
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+size_t pagecacheRead(file_desc_t *file, size_t offset, size_t size, char *buf);
+size_t pagecacheWrite(file_desc_t *file, size_t offset, size_t size, char *buf);
+size_t pagecacheReadv(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt);
+size_t pagecacheWritev(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt);
+
+int pagecacheSync(file_desc_t *file);
+void pagecacheInvalidate(file_desc_t *file);
+size_t pagecacheReclaim(size_t count);
+
+void pagecacheGetStats(pagecache_stats_t *stats);
+
+#endif // _PAGECACHE_H
@@ -7,14 +7,24 @@
 
 #include <stddef.h>
 
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Walks the components of a path without copying it
+typedef struct path_iter_t
+{
+	const char *pos; // Start of the next component
+	const char *end; // End of the walked part of the path
+} path_iter_t;
+
 //------------------------------------------------------------------------------------------
 //				Public Function
 //------------------------------------------------------------------------------------------
 
-char *getPathSubstr(const char *path, size_t index);
-size_t getPathLength(const char *path);
-char *rmPathDirectory(char *path);
-char *getPathFile(const char *path);
-char *getPathDir(const char *path);
+void pathIterInit(path_iter_t *iter, const char *path, size_t length);
+int pathIterNext(path_iter_t *iter, const char **name, size_t *length);
+
+const char *getPathFile(const char *path, size_t *length);
 
 #endif // _PATHUTILS_H
@@ -0,0 +1,30 @@
+#ifndef _PIPE_H
+#define _PIPE_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <vfs/vfs.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define PIPE_BUFFER_MIN 4096        // Initial size of the ring buffer (has to be a power of two)
+#define PIPE_BUFFER_MAX (1024*1024) // The ring buffer doesn't grow past this, writes come up short
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+size_t readPipe(file_desc_t *node, size_t offset, size_t size, char *buf);
+size_t writePipe(file_desc_t *node, size_t offset, size_t size, char *buf);
+void closePipe(file_desc_t *node);
+
+file_desc_t *pipeCreate();
+
+#endif // _PIPE_H
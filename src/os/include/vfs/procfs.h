@@ -0,0 +1,34 @@
+#ifndef _PROCFS_H
+#define _PROCFS_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <vfs/vfs.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define PROCFS_FILE_MAX 4096 // Largest file the procfs generates
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+size_t readProcfs(file_desc_t *node, size_t offset, size_t size, char *buf);
+size_t writeProcfs(file_desc_t *node, size_t offset, size_t size, char *buf);
+int readdirProcfs(DIR *dirstream);
+file_desc_t *findfileProcfs(file_desc_t *node, char *name, bool *missing);
+int mkfileProcfs(file_desc_t *file);
+int rmfileProcfs(file_desc_t *file);
+int renameProcfs(file_desc_t *file, file_desc_t *newParent, char *origName);
+
+mountpoint_t *mountProcfs();
+void unmountProcfs(mountpoint_t *mountpoint);
+
+#endif // _PROCFS_H
@@ -0,0 +1,40 @@
+#ifndef _TMPFS_H
+#define _TMPFS_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <vfs/vfs.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Counters of a mounted tmpfs
+typedef struct tmpfs_stats_t
+{
+	size_t files; // Files and directories besides the root directory
+	size_t pages; // Memory pages holding file data
+} tmpfs_stats_t;
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+size_t readTmpfs(file_desc_t *node, size_t offset, size_t size, char *buf);
+size_t writeTmpfs(file_desc_t *node, size_t offset, size_t size, char *buf);
+int readdirTmpfs(DIR *dirstream);
+file_desc_t *findfileTmpfs(file_desc_t *node, char *name, bool *missing);
+int mkfileTmpfs(file_desc_t *file);
+int rmfileTmpfs(file_desc_t *file);
+int renameTmpfs(file_desc_t *file, file_desc_t *newParent, char *origName);
+
+mountpoint_t *mountTmpfs();
+void unmountTmpfs(mountpoint_t *mountpoint);
+void tmpfsGetStats(mountpoint_t *mountpoint, tmpfs_stats_t *stats);
+
+#endif // _TMPFS_H
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 //------------------------------------------------------------------------------------------
 //				Constants
@@ -42,11 +43,16 @@
 
 #define BUFSIZ 1024 // Standard complete buffer size (one sector for each buffer)
 
+#define IOV_MAX 1024 // Max segments of a vectored read or write
+
 // File flags
 #define FS_FILE      0x01
 #define FS_DIRECTORY 0x02
 #define FS_CHRDEVICE 0x04
 
+// Mount flags
+#define MNT_NOCACHE 0x01 // File data bypasses the page cache (the filesystem lies in memory)
+
 // Dirent flags
 #define DT_DIR 0x01 // Directory
 #define DT_REG 0x02 // Regular file
@@ -64,14 +70,25 @@ struct dirent;
 struct DIR;
 struct mountpoint_t;
 
+// One segment of a vectored read or write
+typedef struct iovec
+{
+	void *iov_base; // Start of the segment
+	size_t iov_len; // Length of the segment
+} iovec;
+
 // Define callback functions reffering to the used filesystem driver
 typedef size_t (*read_callback)(struct file_desc_t *node, size_t offset, size_t size, char *buf);
 typedef size_t (*write_callback)(struct file_desc_t *node, size_t offset, size_t size, char *buf);
+typedef size_t (*readv_callback)(struct file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt);
+typedef size_t (*writev_callback)(struct file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt);
+typedef int (*reserve_callback)(struct file_desc_t *node, size_t size);
 typedef int (*readdir_callback)(struct DIR *dirstream);
-typedef struct file_desc_t *(*findfile_callback)(struct file_desc_t *node, char *name);
+typedef struct file_desc_t *(*findfile_callback)(struct file_desc_t *node, char *name, bool *missing);
 typedef int (*mkfile_callback)(struct file_desc_t *file);
 typedef int (*rmfile_callback)(struct file_desc_t *file);
 typedef int (*rename_callback)(struct file_desc_t *file, struct file_desc_t *newParent, char *origName);
+typedef void (*close_callback)(struct file_desc_t *node);
 
 // Internal VFS node type
 // Holds information like where the file is located
@@ -81,6 +98,7 @@ typedef struct file_desc_t
 	uint32_t flags;              // Flags
 	uint32_t length;             // File length
 	uint32_t inode;              // Used in filesystem driver
+	uint32_t version;            // Changes whenever the file gets written, set by the VFS
 
 	struct mountpoint_t *mount; // Mounted filesystem this file descriptor lies
 
@@ -92,11 +110,15 @@ typedef struct file_desc_t
 	// Callbacks
 	read_callback read;
 	write_callback write;
+	readv_callback readv;     // Optional, the VFS falls back to read
+	writev_callback writev;   // Optional, the VFS falls back to write
+	reserve_callback reserve; // Optional, preallocates space for a file size or releases it above the length
 	readdir_callback readdir;
-	findfile_callback findfile;
+	findfile_callback findfile; // Sets missing if the name doesn't exist, not on errors
 	mkfile_callback mkfile;
 	rmfile_callback rmfile;
 	rename_callback rename;
+	close_callback close; // Optional, called after the last stream of a file outside the node tree got closed
 } file_desc_t;
 
 // External FILE type
@@ -122,6 +144,8 @@ typedef struct FILE
 	// depending on the mode the file is opened in
 	char *ioBuf; // Complete buffer (set by setbuf/setvbuf)
 	char *ioEnd; // End of complete buffer
+
+	size_t refills; // Buffer refills since the last seek or resize (sequential streams get bigger buffers)
 } FILE;
 
 // Directory entry type
@@ -149,9 +173,19 @@ typedef struct mountpoint_t
 	file_desc_t *root;         // Root node of the mounted filesystem
 	partition_t *partition;   // Partition where filesystem is located
 	uintptr_t metadata;       // Pointer to unique metadata for every filesystem driver
+	size_t blockSize;         // Preferred transfer size of the filesystem (the cluster size for FAT32)
+	uint32_t flags;           // Mount flags
 	unmount_callback unmount; // Used to clear metadata info
 } mountpoint_t;
 
+// Counters of the VFS itself
+typedef struct vfs_stats_t
+{
+	size_t nodes;         // Nodes in memory besides the root node
+	size_t nodeBudget;    // Nodes kept before cold ones get evicted
+	size_t pooledBuffers; // Free stream buffers kept for reuse
+} vfs_stats_t;
+
 
 //------------------------------------------------------------------------------------------
 //				Variables
@@ -168,7 +202,12 @@ FILE *vfsReopen(const char *path, const char *mode, FILE *stream);
 void vfsClose(FILE *file);
 size_t vfsRead(FILE *file, void *buf, size_t size);
 size_t vfsWrite(FILE *file, const void *buf, size_t size);
+size_t vfsReadv(FILE *file, const struct iovec *iov, int iovcnt);
+size_t vfsWritev(FILE *file, const struct iovec *iov, int iovcnt);
+size_t vfsCopyRange(FILE *in, FILE *out, size_t len);
+int vfsPipe(FILE **readEnd, FILE **writeEnd);
 
+size_t vfsTell(FILE *file);
 int vfsSeek(FILE *file, long offset, int origin);
 int vfsFlush(FILE *file);
 int vfsSetvbuf(FILE *file, char *buf, int mode, size_t size);
@@ -186,4 +225,6 @@ DIR *vfsOpendir(const char *path);
 int vfsClosedir(DIR *dir);
 dirent *vfsReaddir(DIR *dir);
 
+void vfsGetStats(vfs_stats_t *stats);
+
 #endif // _VFS_H
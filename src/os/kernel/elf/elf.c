@@ -5,6 +5,8 @@
 //------------------------------------------------------------------------------------------
 #include <memory/heap.h>
 
+#include <string.h>
+
 //------------------------------------------------------------------------------------------
 //				Constants
 //------------------------------------------------------------------------------------------
@@ -48,10 +50,8 @@ ELF_header_t* get_elf_header(ELF_FILE* file)
 	//Get a buffer
 	file->header_cache = kmalloc(sizeof(ELF_header_t));
 
-	//Go to start of the file
-	vfsSeek(file->file, 0, SEEK_SET);
 	//Read the actual bytes
-	size_t read = vfsRead(file->file, file->header_cache, sizeof(ELF_header_t));
+	size_t read = read_elf_file(file, 0, sizeof(ELF_header_t), file->header_cache);
 
 	//If not exactly sizeof(ELF_header_t) bytes are read an error occured
 	if(read != sizeof(ELF_header_t))
@@ -89,8 +89,7 @@ ELF_program_header_info_t* get_elf_program_header_info(ELF_FILE* file)
 	ELF_program_header_entry_t* buffer = kmalloc(table_size);
 
 	//Read table into buffer
-	vfsSeek(file->file, table_pos, SEEK_SET);
-	vfsRead(file->file, buffer, table_size);
+	read_elf_file(file, table_pos, table_size, buffer);
 
 	//Create program table info struct
 	ELF_program_header_info_t* table_info = kmalloc(sizeof(ELF_program_header_info_t));
@@ -130,8 +129,7 @@ ELF_section_header_info_t* get_elf_section_header_info(ELF_FILE* file)
 	ELF_section_header_entry_t* buffer = kmalloc(table_size);
 
 	//Read table into buffer
-	vfsSeek(file->file, table_pos, SEEK_SET);
-	vfsRead(file->file, buffer, table_size);
+	read_elf_file(file, table_pos, table_size, buffer);
 
 	//Create program table info struct
 	ELF_section_header_info_t* table_info = kmalloc(sizeof(ELF_section_header_info_t));
@@ -144,6 +142,25 @@ ELF_section_header_info_t* get_elf_section_header_info(ELF_FILE* file)
 	//Return info struct
 	return table_info;
 }
+//Reads a part of the file, from memory if it lies inside the start of the file
+size_t read_elf_file(ELF_FILE* file, size_t offset, size_t size, void* buffer)
+{
+	if(file->head && offset + size <= file->head_size)
+	{
+		memcpy(buffer, &file->head[offset], size);
+		return size;
+	}
+
+	vfsSeek(file->file, offset, SEEK_SET);
+	return vfsRead(file->file, buffer, size);
+}
+//Frees the start of the file once the headers are parsed
+void free_elf_head(ELF_FILE* file)
+{
+	kfree(file->head);
+	file->head = NULL;
+	file->head_size = 0;
+}
 
 //Releases all ELF_FILE related memory
 void dispose_elf_file_struct(ELF_FILE* file)
@@ -151,6 +168,8 @@ void dispose_elf_file_struct(ELF_FILE* file)
 	//Close file itself
 	vfsClose(file->file);
 
+	free_elf_head(file);
+
 	//If header is cached free it
 	if(file->header_cache)
 	{
@@ -190,6 +209,15 @@ ELF_FILE* create_elf_file_struct(FILE* file)
 	ELF_FILE* elf_file = kzalloc(sizeof(ELF_FILE));
 	elf_file->file = file;
 
+	//Read the start of the file at once, the headers are parsed from memory
+	size_t head_size = file->file_desc->length < ELF_HEAD_SIZE ? file->file_desc->length : ELF_HEAD_SIZE;
+	elf_file->head = kmalloc(head_size);
+	if(elf_file->head)
+	{
+		vfsSeek(file, 0, SEEK_SET);
+		elf_file->head_size = vfsRead(file, elf_file->head, head_size);
+	}
+
 	//Test if the file is valid
 	if(!is_elf_valid(elf_file))
 	{
@@ -10,12 +10,15 @@
 
 #include <memory/heap.h>
 
+#include <hal/cpu.h>
+
 #include <vfs/vfs.h>
 
 #include <string.h>
 #include <stdbool.h>
 
 #include <attribute_defs.h>
+#include <debug.h>
 
 #include "relocation.h"
 
@@ -24,13 +27,66 @@
 //------------------------------------------------------------------------------------------
 #define IS_DYNAMIC_NULL_ENTRY(e) (e->type == DST_NULL) //FIXME: ADD FULL SPECIFICATION
 
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+#define LIB_CACHE_SIZE			MAX_LOADED_LIBS	//Resident libraries
+#define LIB_MAX_DATA_SEGMENTS	4				//Writable segments of a resident library
+#define IMAGE_CACHE_SIZE		8				//Relocated executables kept for the next launch
+
+#define KERNEL_LIB_NAME			"libkernel.so"	//Programs link against it to call the kernel
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
+//Writable segment of a resident library as it was after the relocation
+typedef struct
+{
+	void* address;
+	size_t file_size;	//Bytes restored from the copy (.got, .data)
+	size_t zero_size;	//Bytes behind them which get zeroed (.bss)
+	void* copy;
+} lib_data_segment_t;
+//A shared library or an executable image kept in memory between program launches
+typedef struct
+{
+	libinfo_t* libinfo;	//NULL if the entry is unused
+
+	//The file the library was loaded from, in the state it had then
+	mountpoint_t* mount;
+	uint32_t inode;
+	uint32_t length;
+	uint32_t version;
+	bool eager_binding;	//Binding mode the library was loaded with
+
+	size_t users;		//Programs currently using the library
+	bool stale;			//Freed as soon as the last user releases it
+	uint32_t last_use;	//Images only, the least recently used one gets replaced first
+	char name[FILENAME_MAX + 1];	//The file gets closed, so the name is kept here
+
+	lib_data_segment_t segments[LIB_MAX_DATA_SEGMENTS];
+	size_t segment_count;
+} lib_cache_entry_t;
+//Global symbol of the kernel, generated at build time by tools/exports/gen-exports.sh
+typedef struct
+{
+	const char* name;
+	uint32_t address;
+} kernel_export_t;
 
 //------------------------------------------------------------------------------------------
 //				Variables
 //------------------------------------------------------------------------------------------
+static lib_cache_entry_t lib_cache[LIB_CACHE_SIZE];
+static lib_cache_entry_t image_cache[IMAGE_CACHE_SIZE];
+static uint32_t image_cache_clock;
+
+//Stands in for libkernel.so, its symbols come from the export table
+static libinfo_t kernel_libinfo = { .name = KERNEL_LIB_NAME, .resident = true };
+
+//Export table linked into the kernel, sorted by name
+extern const kernel_export_t kernel_exports[];
+extern const uint32_t kernel_export_count;
 
 //------------------------------------------------------------------------------------------
 //				Private function
@@ -45,11 +101,375 @@ static bool check_vars(libinfo_t* libinfo)
 		&& libinfo->string_table_size != 0
 		&& libinfo->symbol_table_base != NULL
 		&& libinfo->symbol_table_entry_size != 0
-		&& libinfo->hash_table_base != NULL
+		&& (libinfo->hash_table_base != NULL || libinfo->gnu_hash_table_base != NULL)
 		? true
 		: false;
 }
 
+//SysV ELF hash of a symbol name (DT_HASH)
+static uint32_t elf_hash(const char* name)
+{
+	uint32_t hash = 0;
+	while(*name)
+	{
+		hash = (hash << 4) + (uint8_t)*name++;
+		uint32_t high = hash & 0xF0000000;
+		if(high)
+			hash ^= high >> 24;
+		hash &= ~high;
+	}
+	return hash;
+}
+//GNU hash of a symbol name (DT_GNU_HASH)
+static uint32_t elf_gnu_hash(const char* name)
+{
+	uint32_t hash = 5381;
+	while(*name)
+		hash = hash * 33 + (uint8_t)*name++;
+	return hash;
+}
+//Counts the dynamic symbols of a library
+static size_t count_symbols(libinfo_t* libinfo)
+{
+	//nchain of the SysV table equals the symbol count
+	if(libinfo->hash_table_base)
+		return ((uint32_t*)libinfo->hash_table_base)[1];
+
+	//The GNU table only covers the symbols from symoffset on
+	//Walk to the end of the chain starting in the highest bucket
+	uint32_t* table = libinfo->gnu_hash_table_base;
+	uint32_t bucket_count = table[0];
+	uint32_t symoffset = table[1];
+	uint32_t bloom_size = table[2];
+	uint32_t* buckets = &table[4 + bloom_size];
+	uint32_t* chain = &buckets[bucket_count];
+
+	uint32_t last = 0;
+	for(uint32_t i = 0; i < bucket_count; i++)
+	{
+		if(buckets[i] > last)
+			last = buckets[i];
+	}
+	if(last < symoffset)
+		return symoffset;
+
+	while(!(chain[last - symoffset] & 1))
+		last++;
+
+	return last + 1;
+}
+//Looks the name up in the GNU hash table of the library
+static ELF_symbol_table_entry_t* find_symbol_gnu(libinfo_t* lib, const char* name, uint32_t hash)
+{
+	uint32_t* table = lib->gnu_hash_table_base;
+	uint32_t bucket_count = table[0];
+	uint32_t symoffset = table[1];
+	uint32_t bloom_size = table[2];
+	uint32_t bloom_shift = table[3];
+	uint32_t* bloom = &table[4];
+	uint32_t* buckets = &bloom[bloom_size];
+	uint32_t* chain = &buckets[bucket_count];
+
+	//The bloom filter rejects most names the library doesn't define
+	uint32_t word = bloom[(hash / 32) % bloom_size];
+	uint32_t mask = (1u << (hash % 32)) | (1u << ((hash >> bloom_shift) % 32));
+	if((word & mask) != mask)
+		return NULL;
+
+	uint32_t index = buckets[hash % bucket_count];
+	if(index < symoffset)
+		return NULL;
+
+	//Symbols of a bucket are adjacent, the lowest bit marks the last one
+	for(;; index++)
+	{
+		uint32_t chain_hash = chain[index - symoffset];
+		ELF_symbol_table_entry_t* entry = &lib->symbol_table_base[index];
+
+		if((chain_hash | 1) == (hash | 1) && strcmp(&lib->string_table_base[entry->name], name) == 0)
+			return entry;
+		if(chain_hash & 1)
+			return NULL;
+	}
+}
+//Looks the name up in the SysV hash table of the library
+static ELF_symbol_table_entry_t* find_symbol_sysv(libinfo_t* lib, const char* name, uint32_t hash)
+{
+	uint32_t* table = lib->hash_table_base;
+	uint32_t bucket_count = table[0];
+	uint32_t* buckets = &table[2];
+	uint32_t* chain = &buckets[bucket_count];
+
+	for(uint32_t index = buckets[hash % bucket_count]; index != 0; index = chain[index])
+	{
+		ELF_symbol_table_entry_t* entry = &lib->symbol_table_base[index];
+
+		if(entry->shndx != SHN_UNDEF && strcmp(&lib->string_table_base[entry->name], name) == 0)
+			return entry;
+	}
+	return NULL;
+}
+//Finds the definition of a symbol inside the library
+//Returns NULL if the library doesn't define it
+static ELF_symbol_table_entry_t* find_symbol(libinfo_t* lib, const char* name, uint32_t sysv_hash, uint32_t gnu_hash)
+{
+	if(lib->gnu_hash_table_base)
+		return find_symbol_gnu(lib, name, gnu_hash);
+	if(lib->hash_table_base)
+		return find_symbol_sysv(lib, name, sysv_hash);
+
+	//Without a hash table every symbol has to be compared
+	for(size_t i = 1; i < lib->symbol_count; i++)
+	{
+		ELF_symbol_table_entry_t* entry = &lib->symbol_table_base[i];
+
+		if(entry->shndx != SHN_UNDEF && strcmp(&lib->string_table_base[entry->name], name) == 0)
+			return entry;
+	}
+	return NULL;
+}
+//Finds the address of a kernel symbol with a binary search of the export table
+//Returns 0 if the kernel doesn't export it
+static uint32_t find_kernel_export(const char* name)
+{
+	uint32_t low = 0;
+	uint32_t high = kernel_export_count;
+
+	while(low < high)
+	{
+		uint32_t middle = low + (high - low) / 2;
+		int order = strcmp(name, kernel_exports[middle].name);
+
+		if(order == 0)
+			return kernel_exports[middle].address;
+		if(order < 0)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return 0;
+}
+//Needed libraries of a resident library get acquired too
+static int handle_needed_libs(char* name);
+
+//Finds the resident library with the name
+static lib_cache_entry_t* lib_cache_find(const char* name)
+{
+	for(size_t i = 0; i < LIB_CACHE_SIZE; i++)
+	{
+		if(lib_cache[i].libinfo && !lib_cache[i].stale && strcmp(LIBINFO_NAME(lib_cache[i].libinfo), name) == 0)
+			return &lib_cache[i];
+	}
+	return NULL;
+}
+//Opens the file of a library, they are searched in the root dir
+static FILE* open_lib(const char* name)
+{
+	size_t len = strlen(name);
+	char* file_name = kzalloc(len + 2);
+	file_name[0] = '/';
+	strcpy(&file_name[1], name);
+
+	FILE* file = vfsOpen(file_name, "r");
+	kfree(file_name);
+	return file;
+}
+//Checks if the entry was loaded from the file in its current state
+//The relocated GOT only fits if the binding mode didn't change since then
+static bool lib_cache_matches(lib_cache_entry_t* entry, file_desc_t* file)
+{
+	return entry->mount == file->mount
+		&& entry->inode == file->inode
+		&& entry->length == file->length
+		&& entry->version == file->version
+		&& entry->eager_binding == linker_eager_binding;
+}
+//Frees the entries of the cache depending on the library
+static void lib_cache_free_dependents(lib_cache_entry_t* cache, size_t size, const char* name);
+//Checks if the resident libraries the library needs are still usable
+//Nothing gets acquired, so a stale one is found before a library relocated against it is used
+static bool lib_cache_deps_valid(libinfo_t* libinfo, size_t depth)
+{
+	//Libraries can't need each other in a cycle
+	if(depth == MAX_LOADED_LIBS)
+		return false;
+
+	for(size_t i = 0; i < libinfo->lib_count; i++)
+	{
+		if(strcmp(libinfo->libs[i], KERNEL_LIB_NAME) == 0)
+			continue;
+
+		//A library which isn't resident gets loaded to another address
+		lib_cache_entry_t* entry = lib_cache_find(libinfo->libs[i]);
+		FILE* file = entry ? open_lib(libinfo->libs[i]) : NULL;
+		if(!file)
+			return false;
+
+		bool valid = lib_cache_matches(entry, file->file_desc);
+		vfsClose(file);
+
+		if(!valid || !lib_cache_deps_valid(entry->libinfo, depth + 1))
+			return false;
+	}
+	return true;
+}
+//Frees a resident library or image nobody uses
+//Entries depending on it are freed first, their relocations point into it
+static void lib_cache_free_entry(lib_cache_entry_t* entry)
+{
+	const char* name = LIBINFO_NAME(entry->libinfo);
+	lib_cache_free_dependents(lib_cache, LIB_CACHE_SIZE, name);
+	lib_cache_free_dependents(image_cache, IMAGE_CACHE_SIZE, name);
+
+	for(size_t i = 0; i < entry->segment_count; i++)
+		kfree(entry->segments[i].copy);
+
+	linker_free_lib(entry->libinfo);
+	memset(entry, 0, sizeof(lib_cache_entry_t));
+}
+static void lib_cache_free_dependents(lib_cache_entry_t* cache, size_t size, const char* name)
+{
+	for(size_t i = 0; i < size; i++)
+	{
+		libinfo_t* lib = cache[i].libinfo;
+		for(size_t j = 0; lib && j < lib->lib_count; j++)
+		{
+			if(strcmp(lib->libs[j], name) == 0)
+			{
+				//A running program still uses it, it's freed when the program releases it
+				if(cache[i].users)
+					cache[i].stale = true;
+				else
+					lib_cache_free_entry(&cache[i]);
+				break;
+			}
+		}
+	}
+}
+//Saves the writable segments of a freshly loaded and relocated library
+//Returns false if they can't be saved
+static bool lib_cache_save_segments(lib_cache_entry_t* entry, libinfo_t* libinfo)
+{
+	ELF_program_header_info_t* header = get_elf_program_header_info(libinfo->file);
+	for(uint16_t i = 0; i < header->entry_count; i++)
+	{
+		ELF_program_header_entry_t* current_header = &header->base[i];
+		if(current_header->type != PHT_LOAD || !(current_header->flags & PHF_WRITE))
+			continue;
+
+		lib_data_segment_t* segment = &entry->segments[entry->segment_count];
+		if(entry->segment_count == LIB_MAX_DATA_SEGMENTS || !(segment->copy = kmalloc(current_header->segment_size)))
+		{
+			for(size_t j = 0; j < entry->segment_count; j++)
+				kfree(entry->segments[j].copy);
+			memset(entry, 0, sizeof(lib_cache_entry_t));
+			return false;
+		}
+
+		segment->address = RESOLVE_MEM_ADDRESS(libinfo, current_header->vaddr);
+		segment->file_size = current_header->segment_size;
+		segment->zero_size = current_header->memory_size - current_header->segment_size;
+		memcpy(segment->copy, segment->address, segment->file_size);
+		entry->segment_count++;
+	}
+
+	file_desc_t* file_desc = libinfo->file->file->file_desc;
+	entry->mount = file_desc->mount;
+	entry->inode = file_desc->inode;
+	entry->length = file_desc->length;
+	entry->version = file_desc->version;
+	entry->eager_binding = linker_eager_binding;
+	return true;
+}
+//Resets the writable segments to their state after the relocation
+static void lib_cache_restore_segments(lib_cache_entry_t* entry)
+{
+	for(size_t i = 0; i < entry->segment_count; i++)
+	{
+		lib_data_segment_t* segment = &entry->segments[i];
+		memcpy(segment->address, segment->copy, segment->file_size);
+		memset((char*)segment->address + segment->file_size, 0, segment->zero_size);
+	}
+}
+//Closes the file of a library or image once it is cached
+//Nothing reads it anymore and an open file couldn't be removed or replaced
+static void lib_cache_close_file(lib_cache_entry_t* entry, libinfo_t* libinfo)
+{
+	strcpy(entry->name, libinfo->file->file->file_desc->name);
+	libinfo->name = entry->name;
+
+	dispose_elf_file_struct(libinfo->file);
+	libinfo->file = NULL;
+}
+//Makes a freshly loaded and relocated library resident
+//Its writable segments are saved, so the following programs get them in the same state
+static void lib_cache_insert(libinfo_t* libinfo)
+{
+	//Take a free entry or replace a library nobody uses
+	lib_cache_entry_t* entry = NULL;
+	for(size_t i = 0; i < LIB_CACHE_SIZE && !entry; i++)
+	{
+		if(!lib_cache[i].libinfo)
+			entry = &lib_cache[i];
+	}
+	for(size_t i = 0; i < LIB_CACHE_SIZE && !entry; i++)
+	{
+		if(lib_cache[i].users == 0)
+		{
+			lib_cache_free_entry(&lib_cache[i]);
+			entry = &lib_cache[i];
+		}
+	}
+	//If the cache is full the library is freed when the program exits
+	if(!entry)
+		return;
+
+	//Can't be restored, so it stays a library of this program only
+	if(!lib_cache_save_segments(entry, libinfo))
+		return;
+
+	lib_cache_close_file(entry, libinfo);
+
+	entry->libinfo = libinfo;
+	entry->users = 1;
+	libinfo->resident = true;
+}
+//Uses the resident copy of a library for the current program
+//Resets its writable segments and acquires the libraries it needs
+//Returns 1 if there is no usable resident copy
+static int lib_cache_acquire(char* name, FILE* file)
+{
+	lib_cache_entry_t* entry = lib_cache_find(name);
+	if(!entry)
+		return 1;
+
+	//The file got replaced or written since the library was loaded or the binding mode changed
+	//The libraries it needs are checked before anything gets acquired
+	if(!lib_cache_matches(entry, file->file_desc) || !lib_cache_deps_valid(entry->libinfo, 0))
+	{
+		if(entry->users == 0)
+			lib_cache_free_entry(entry);
+		return 1;
+	}
+
+	if(loaded_lib_count == MAX_LOADED_LIBS)
+		return -3;
+
+	lib_cache_restore_segments(entry);
+
+	entry->users++;
+	loaded_libs[loaded_lib_count++] = entry->libinfo;
+
+	int returnCode;
+	for(size_t i = 0; i < entry->libinfo->lib_count; i++)
+	{
+		if((returnCode = handle_needed_libs(entry->libinfo->libs[i])))
+			return returnCode;
+	}
+
+	return 0;
+}
+
 //Handles NEEDED entries of the dynamic section
 //EXCEPTIONS:
 //	-1: No such file
@@ -57,21 +477,39 @@ static bool check_vars(libinfo_t* libinfo)
 //	-3: Too many loaded libraries
 static int handle_needed_libs(char* name)
 {
-	//Process filename
+	//Every library is only loaded once per program
+	for(size_t i = 0; i < loaded_lib_count; i++)
+	{
+		if(strcmp(LIBINFO_NAME(loaded_libs[i]), name) == 0)
+			return 0;
+	}
+
+	//The kernel is already in memory, libkernel.so is never read
+	if(strcmp(name, KERNEL_LIB_NAME) == 0)
+	{
+		//We can only have MAX_LOADED_LIBS libraries
+		if(loaded_lib_count == MAX_LOADED_LIBS)
+			return -3;
+
+		loaded_libs[loaded_lib_count++] = &kernel_libinfo;
+		return 0;
+	}
+
 	//Search lib in root dir
-	size_t len = strlen(name);
-	char* file_name = kzalloc(len + 2);
-	file_name[0] = '/';
-	strcpy(&file_name[1], name);
-	//Open file
-	FILE* file = vfsOpen(file_name, "r");
-	//Free memory
-	kfree(file_name);
+	FILE* file = open_lib(name);
 
 	//If we don't have a valid file descriptor the library don't exist
 	if(!file)
 		return -1;
 
+	//Use the resident copy if the file didn't change
+	int returnCode = lib_cache_acquire(name, file);
+	if(returnCode != 1)
+	{
+		vfsClose(file);
+		return returnCode;
+	}
+
 	//Extend it to an ELF_FILE
 	ELF_FILE* elf_file = create_elf_file_struct(file);
 
@@ -85,92 +523,69 @@ static int handle_needed_libs(char* name)
 
 	//Get an libinfo struct
 	libinfo_t* libinfo = kzalloc(sizeof(libinfo_t));
+	libinfo->name = file->file_desc->name;
 	libinfo->file = elf_file;
 
-	//Special handling for kernel linkage
-	if(strcmp(name, "libkernel.so") == 0)
+	//Handle as generic library
+	if((returnCode = process_program_header(libinfo)))
+		return returnCode;
+
+	//Keep it in memory for the following programs
+	lib_cache_insert(libinfo);
+	return 0;
+}
+//Collects the loaded libs the library depends on
+//Returns the count of the libs
+static size_t collect_deps(libinfo_t* libinfo, libinfo_t** deps)
+{
+	size_t dep_count = 0;
+	for(size_t i = 0; i < loaded_lib_count; i++)
 	{
-		//Test if already loaded
-		for(size_t i = 0; i < loaded_lib_count; i++)
+		for(size_t dep_lib_index = 0; dep_lib_index < libinfo->lib_count; dep_lib_index++)
 		{
-			if(strcmp(LIBINFO_NAME(loaded_libs[i]), "libkernel.so") == 0)
+			if(strcmp(LIBINFO_NAME(loaded_libs[i]), libinfo->libs[dep_lib_index]) == 0)
 			{
-				//Free memory
-				LIBINFO_FREE(libinfo)
-				return 0;
+				deps[dep_count++] = loaded_libs[i];
+				break;
 			}
 		}
+	}
+	return dep_count;
+}
+//Gets the load time address of a symbol inside the libs
+//Returns 0 if no lib defines it
+static uint32_t lookup_symbol(libinfo_t** deps, size_t dep_count, const char* name)
+{
+	//Hash the name once for all libraries
+	uint32_t sysv_hash = elf_hash(name);
+	uint32_t gnu_hash = elf_gnu_hash(name);
 
-		//We can only have MAX_LOADED_LIBS libraries
-		if(loaded_lib_count == MAX_LOADED_LIBS)
-			return -3;
-
-		//Add as loaded lib
-		loaded_libs[loaded_lib_count++] = libinfo;
-
-		//Get DYNSYM and DYNSTR section out of the section header
-		size_t dynsym_file_offset = 0, dynsym_file_size = 0, dynstr_file_offset = 0, dynstr_file_size = 0;
-		ELF_section_header_info_t* header = get_elf_section_header_info(libinfo->file);
-		ELF_header_t* elf_header = get_elf_header(libinfo->file);
-		ELF_section_header_entry_t* section_string_table_entry = &header->base[elf_header->section_header_table_name_index];	//String table containing the section names
-		char* buffer;
-
-		//First load the string table
-		READ_FROM_DISK(libinfo, buffer, section_string_table_entry->offset, section_string_table_entry->size)
-
-		//Search through the section header
-		for(uint16_t i = 0; i < header->entry_count && (dynsym_file_offset == 0 || dynstr_file_offset == 0); i++)
+	for(size_t i = 0; i < dep_count; i++)
+	{
+		if(deps[i] == &kernel_libinfo)
 		{
-			ELF_section_header_entry_t* current_header = &header->base[i];
-
-			switch(current_header->type)
-			{
-				//There should be only one such section
-				case SHT_DYNSYM:
-					dynsym_file_offset = current_header->offset;
-					dynsym_file_size = current_header->size;
-					break;
-				//There are multiple sections with this type
-				case SHT_STRTAB:
-					//Test if we found the searched one
-					if(strcmp(&buffer[current_header->name], ".dynstr") == 0)
-					{
-						dynstr_file_offset = current_header->offset;
-						dynstr_file_size = current_header->size;
-					}
-					break;
-				default:
-					break;
-			}
+			uint32_t address = find_kernel_export(name);
+			if(address)
+				return address;
+			continue;
 		}
 
-		//The string table is no longer needed so free the buffer
-		kfree(buffer);
-
-		//Load DYNSYM on heap and set libinfo fields accordingly
-		READ_FROM_DISK(libinfo, buffer, dynsym_file_offset, dynsym_file_size)
-		libinfo->symbol_table_base = (ELF_symbol_table_entry_t*)buffer;
-		libinfo->symbol_table_entry_size = sizeof(ELF_symbol_table_entry_t);
-		libinfo->page_count = dynsym_file_size;
-
-		//Load DYNSTR on heap and set libinfo accordingly
-		READ_FROM_DISK(libinfo, buffer, dynstr_file_offset, dynstr_file_size)
-		libinfo->string_table_base = buffer;
-		libinfo->string_table_size = dynstr_file_size;
-
-		return 0;
+		ELF_symbol_table_entry_t* entry = find_symbol(deps[i], name, sysv_hash, gnu_hash);
+		if(entry)
+			return (uint32_t)RESOLVE_MEM_ADDRESS(deps[i], entry->value);
 	}
-
-	//Handle as generic library
-	return process_program_header(libinfo);
+	return 0;
 }
 //Resolves dynamic linked symbols of a library
 //EXCEPTIONS:
-//	-1: Could not find section in section table
 //	-2: Could not resolve symbol address
 //	-3: Could not handle entry type
 int resolve_symbols(libinfo_t* libinfo)
 {
+	//Collect the loaded libs this library depends on once
+	libinfo_t* deps[MAX_LOADED_LIBS];
+	size_t dep_count = collect_deps(libinfo, deps);
+
 	//Loop until every entry is resolved
 	while(libinfo->last_dynamic_entry)
 	{
@@ -180,72 +595,9 @@ int resolve_symbols(libinfo_t* libinfo)
 		uint8_t type = libinfo->last_dynamic_entry->type;
 		uint32_t addend = libinfo->last_dynamic_entry->addend;
 
-		uint32_t load_time_address = 0;
-		//Search symbol in libs
-		for(size_t i = 0; i < loaded_lib_count && load_time_address == 0; i++)
-		{
-			//get lib entry
-			libinfo_t* lib = loaded_libs[i];
-			//Test if we need depend on this lib
-			bool needed = false;
-			for(size_t dep_lib_index = 0; dep_lib_index < libinfo->lib_count; dep_lib_index++)
-			{
-				char* dep_lib_name = libinfo->libs[dep_lib_index];
-				if(strcmp(LIBINFO_NAME(lib), dep_lib_name) == 0)
-				{
-					needed = true;
-					break;
-				}
-			}
-			//If not just skip it
-			if(!needed)
-				continue;
-
-			//Get symbol table entry count
-			size_t symbol_table_entry_count;
-			//Handle libkernel.so separate
-			if(strcmp(LIBINFO_NAME(lib), "libkernel.so"))
-			{
-				//If it is not the kernel library just look in the section header table
-				ELF_section_header_entry_t* symbol_table_section_entry;
-				ELF_section_header_info_t* section_header_info = get_elf_section_header_info(lib->file);
-				for(size_t j = 0; j < section_header_info->entry_count; j++)
-				{
-					ELF_section_header_entry_t* entry = &section_header_info->base[j];
-					//Test if this section is the searched by testing the memory address
-					if(RESOLVE_MEM_ADDRESS(lib, entry->addr) == lib->symbol_table_base)
-					{
-						symbol_table_section_entry = entry;
-						break;
-					}
-				}
-				if(!symbol_table_section_entry)
-					return -1;
-
-				symbol_table_entry_count = symbol_table_section_entry->size / symbol_table_section_entry->entry_size;
-			}
-			else
-			{
-				//If it is the kernel library the total size is in page_count
-				symbol_table_entry_count = lib->page_count / lib->symbol_table_entry_size;
-			}
-			
+		//Search symbol in the libs the library depends on
+		uint32_t load_time_address = lookup_symbol(deps, dep_count, name);
 
-			//Loop through the symbol table
-			for(size_t j = 0; j < symbol_table_entry_count; j++)
-			{
-				ELF_symbol_table_entry_t* entry = &lib->symbol_table_base[j];
-				char* entry_name = &lib->string_table_base[entry->name];
-
-				//Test if the current symbol is the searched
-				if(strcmp(entry_name, name) == 0)
-				{
-					load_time_address = (uint32_t)RESOLVE_MEM_ADDRESS(lib, entry->value);
-					break;
-				}
-			}
-		}
-		
 		//If the symbol is not resolved something went wrong
 		if(!load_time_address)
 			return -2;
@@ -297,7 +649,8 @@ int resolve_symbols(libinfo_t* libinfo)
 //	-20: resolve_symbols
 int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entry)
 {
-	int returnCode;
+	int returnCode = 0;
+	bool bind_now = linker_eager_binding;
 
 	//Get the dynamic section address in memory
 	ELF_dynamic_section_entry_t* dyn_entry = (ELF_dynamic_section_entry_t*)RESOLVE_MEM_ADDRESS(libinfo, entry->vaddr);
@@ -319,6 +672,10 @@ int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entr
 				//Set the according var
 				libinfo->hash_table_base = RESOLVE_MEM_ADDRESS(libinfo, dyn_entry->value.ptr);
 				break;
+			case DST_GNU_HASH:
+				//Set the according var
+				libinfo->gnu_hash_table_base = RESOLVE_MEM_ADDRESS(libinfo, dyn_entry->value.ptr);
+				break;
 			case DST_STRTAB:
 				//Set the according var
 				libinfo->string_table_base = RESOLVE_MEM_ADDRESS(libinfo, dyn_entry->value.ptr);
@@ -380,6 +737,15 @@ int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entr
 						: RELOC_NULL;
 				break;
 
+			case DST_BIND_NOW:
+				//The library requests eager binding
+				bind_now = true;
+				break;
+			case DST_FLAGS:
+				if(dyn_entry->value.val & DF_BIND_NOW)
+					bind_now = true;
+				break;
+
 			case DST_INIT:
 			case DST_FINI:
 				//Can't handle this needed section
@@ -400,6 +766,8 @@ int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entr
 	if(!check_vars(libinfo))
 		return -2;
 
+	libinfo->symbol_count = count_symbols(libinfo);
+
 	//First process needed libs
 	if(libinfo->last_needed_entry)
 	{
@@ -432,7 +800,18 @@ int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entr
 	if(libinfo->plt_got_info.type != RELOC_NULL)
 	{
 		libinfo->plt_got_info.entry_size = libinfo->plt_got_info.type == RELOC_REL ? sizeof(ELF_Rel) : libinfo->plt_got_info.type == RELOC_RELA ? sizeof(ELF_Rela) : 0;
-		process_relocation(libinfo, libinfo->plt_got_info);
+
+		//PLT slots get resolved on their first call unless eager binding is requested
+		//The PLT passes GOT[1] and the relocation offset to the function in GOT[2]
+		if(!bind_now && libinfo->plt_got_address)
+		{
+			uint32_t* got = RESOLVE_MEM_ADDRESS(libinfo, (uint32_t)libinfo->plt_got_address);
+			got[1] = (uint32_t)libinfo;
+			got[2] = (uint32_t)&dynamic_linker_lazy_trampoline;
+			returnCode = process_lazy_relocation(libinfo, libinfo->plt_got_info);
+		}
+		else
+			returnCode = process_relocation(libinfo, libinfo->plt_got_info);
 	}
 	if(returnCode)
 		return returnCode - 10;
@@ -457,4 +836,169 @@ void dynamic_linker_add_dynamic_linking(libinfo_t* libinfo, uint32_t* address, s
 
 	//Update last entry
 	libinfo->last_dynamic_entry = symbol;
-}
\ No newline at end of file
+}
+//Hands a resident library or image back to the cache when a program exits
+//The kernel isn't part of the cache, so nothing happens for it
+void dynamic_linker_release_lib(libinfo_t* libinfo)
+{
+	for(size_t i = 0; i < LIB_CACHE_SIZE; i++)
+	{
+		if(lib_cache[i].libinfo == libinfo)
+		{
+			if(--lib_cache[i].users == 0 && lib_cache[i].stale)
+				lib_cache_free_entry(&lib_cache[i]);
+			return;
+		}
+	}
+	for(size_t i = 0; i < IMAGE_CACHE_SIZE; i++)
+	{
+		if(image_cache[i].libinfo == libinfo)
+		{
+			if(--image_cache[i].users == 0 && image_cache[i].stale)
+				lib_cache_free_entry(&image_cache[i]);
+			return;
+		}
+	}
+}
+//Uses the cached image of the executable for the current program
+//Resets its writable segments and acquires the libraries it needs
+//Returns NULL if there is no usable image, the executable has to be loaded from its file then
+libinfo_t* dynamic_linker_acquire_image(FILE* executable)
+{
+	file_desc_t* file_desc = executable->file_desc;
+	lib_cache_entry_t* entry = NULL;
+	for(size_t i = 0; i < IMAGE_CACHE_SIZE && !entry; i++)
+	{
+		if(image_cache[i].libinfo && !image_cache[i].stale && image_cache[i].mount == file_desc->mount && image_cache[i].inode == file_desc->inode)
+			entry = &image_cache[i];
+	}
+	if(!entry || entry->users)
+		return NULL;
+
+	//The file got written or the binding mode changed since the image was made
+	if(!lib_cache_matches(entry, file_desc))
+	{
+		lib_cache_free_entry(entry);
+		return NULL;
+	}
+
+	//A replaced library drops the images depending on it
+	libinfo_t* libinfo = entry->libinfo;
+	for(size_t i = 0; i < libinfo->lib_count; i++)
+	{
+		if(handle_needed_libs(libinfo->libs[i]) || entry->libinfo != libinfo)
+			return NULL;
+	}
+
+	if(loaded_lib_count == MAX_LOADED_LIBS)
+		return NULL;
+
+	lib_cache_restore_segments(entry);
+
+	entry->users++;
+	entry->last_use = ++image_cache_clock;
+	loaded_libs[loaded_lib_count++] = libinfo;
+
+	return libinfo;
+}
+//Keeps a freshly loaded and relocated executable as an image for the following launches
+void dynamic_linker_insert_image(libinfo_t* libinfo)
+{
+	//The relocations may only point into libraries which stay in memory
+	libinfo_t* deps[MAX_LOADED_LIBS];
+	size_t dep_count = collect_deps(libinfo, deps);
+	if(dep_count != libinfo->lib_count)
+		return;
+	for(size_t i = 0; i < dep_count; i++)
+	{
+		if(!deps[i]->resident)
+			return;
+	}
+
+	//Take a free entry or replace the least recently used image nobody uses
+	lib_cache_entry_t* entry = NULL;
+	for(size_t i = 0; i < IMAGE_CACHE_SIZE; i++)
+	{
+		if(!image_cache[i].libinfo)
+		{
+			entry = &image_cache[i];
+			break;
+		}
+		if(image_cache[i].users == 0 && (!entry || image_cache[i].last_use < entry->last_use))
+			entry = &image_cache[i];
+	}
+	if(!entry)
+		return;
+	if(entry->libinfo)
+		lib_cache_free_entry(entry);
+
+	if(!lib_cache_save_segments(entry, libinfo))
+		return;
+
+	lib_cache_close_file(entry, libinfo);
+
+	entry->libinfo = libinfo;
+	entry->users = 1;
+	entry->last_use = ++image_cache_clock;
+	libinfo->resident = true;
+}
+//Frees the images no program uses, so their memory can be used otherwise
+void dynamic_linker_drop_images(void)
+{
+	for(size_t i = 0; i < IMAGE_CACHE_SIZE; i++)
+	{
+		if(image_cache[i].libinfo && image_cache[i].users == 0)
+			lib_cache_free_entry(&image_cache[i]);
+	}
+}
+//Counts the cached images
+size_t dynamic_linker_image_count(void)
+{
+	size_t count = 0;
+	for(size_t i = 0; i < IMAGE_CACHE_SIZE; i++)
+	{
+		if(image_cache[i].libinfo)
+			count++;
+	}
+	return count;
+}
+//Resolves the symbol of a PLT slot on its first call and patches the slot
+//Called by the trampoline with the library and the offset of the relocation inside the PLT relocation table
+uint32_t dynamic_linker_lazy_resolve(libinfo_t* libinfo, uint32_t reloc_offset)
+{
+	ELF_Rel* entry = (ELF_Rel*)((uintptr_t)libinfo->plt_got_info.address + reloc_offset);
+	char* name = &libinfo->string_table_base[libinfo->symbol_table_base[ELF32_R_SYM(entry->info)].name];
+
+	libinfo_t* deps[MAX_LOADED_LIBS];
+	size_t dep_count = collect_deps(libinfo, deps);
+	uint32_t load_time_address = lookup_symbol(deps, dep_count, name);
+
+	//The program can't continue without the function
+	if(!load_time_address)
+	{
+		debug_printf("[LD] Could not resolve %s", name);
+		halt();
+	}
+
+	*(uint32_t*)RESOLVE_MEM_ADDRESS(libinfo, entry->offset) = load_time_address;
+	return load_time_address;
+}
+
+//Entry of the lazy binding, jumped to by the first PLT entry
+//Stack: libinfo, relocation offset, return address into the caller
+//Saves the caller-saved registers, resolves the slot and jumps to the function
+__asm__(
+	".global dynamic_linker_lazy_trampoline\n"
+	"dynamic_linker_lazy_trampoline:\n"
+	"	pushl %eax\n"
+	"	pushl %ecx\n"
+	"	pushl %edx\n"
+	"	pushl 16(%esp)\n"	//Relocation offset
+	"	pushl 16(%esp)\n"	//libinfo
+	"	call dynamic_linker_lazy_resolve\n"
+	"	addl $8, %esp\n"
+	"	popl %edx\n"
+	"	popl %ecx\n"
+	"	xchgl %eax, (%esp)\n"	//Restore eax and put the function address on the stack
+	"	ret $8\n"				//Jump to the function and drop libinfo and the relocation offset
+);
\ No newline at end of file
@@ -30,5 +30,19 @@
 int process_dynamic_section(libinfo_t* libinfo, ELF_program_header_entry_t* entry);
 //Add an entry to the needed dynamic linked symbol linklist
 void dynamic_linker_add_dynamic_linking(libinfo_t* libinfo, uint32_t* address, size_t name_index, uint8_t type, uint32_t addend);
+//Hands a resident library or image back to the cache when a program exits
+void dynamic_linker_release_lib(libinfo_t* libinfo);
+//Uses the cached image of the executable for the current program
+libinfo_t* dynamic_linker_acquire_image(FILE* executable);
+//Keeps a freshly loaded and relocated executable as an image for the following launches
+void dynamic_linker_insert_image(libinfo_t* libinfo);
+//Frees the images no program uses, so their memory can be used otherwise
+void dynamic_linker_drop_images(void);
+//Counts the cached images
+size_t dynamic_linker_image_count(void);
+//Resolves the symbol of a PLT slot on its first call and patches the slot
+uint32_t dynamic_linker_lazy_resolve(libinfo_t* libinfo, uint32_t reloc_offset);
+//Entry of the lazy binding, jumped to by the first PLT entry
+void dynamic_linker_lazy_trampoline(void);
 
 #endif
\ No newline at end of file
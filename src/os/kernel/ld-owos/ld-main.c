@@ -7,8 +7,12 @@
 
 #include <memory/pmm.h>
 #include <memory/heap.h>
+#include <memory/arena.h>
 
 #include <vfs/vfs.h>
+#include <vfs/pagecache.h>
+
+#include <hal/pit.h>
 
 #include <string.h>
 #include <stdbool.h>
@@ -20,6 +24,9 @@
 //------------------------------------------------------------------------------------------
 //				Macro
 //------------------------------------------------------------------------------------------
+#define MAX_LOAD_IOV 16	//Segments and gaps between them read with one vectored read
+//Size to pass to pmmAllocRegion and pmmFreeRegion for the pages, they also take the block behind it
+#define STATIC_REGION_BYTES(pages) (((pages) - 1) * PMM_BLOCK_SIZE)
 
 //------------------------------------------------------------------------------------------
 //				Types
@@ -33,6 +40,11 @@
 libinfo_t* loaded_libs[MAX_LOADED_LIBS];
 size_t loaded_lib_count;
 
+//Resolve every PLT slot before the program starts instead of on its first call
+bool linker_eager_binding = false;
+
+static linker_stats_t stats;
+
 //The dynamic linked shell streams
 FILE* stdout;
 FILE* stdin;
@@ -80,19 +92,47 @@ static int getPages(libinfo_t* libinfo)
 			//If not set then the min address is at the start aligned by the value in alignment
 			minAddress = current_header->vaddr - (current_header->vaddr % current_header->alignment);
 
-		if(maxAddress <= current_header->vaddr)
-		{
-			//Align by alignment
-			maxAddress = current_header->vaddr - (current_header->vaddr % current_header->alignment) + current_header->alignment;
-		}
+		//The segment ends behind its .bss
+		if(maxAddress < current_header->vaddr + current_header->memory_size)
+			maxAddress = current_header->vaddr + current_header->memory_size;
 	}
 
 	//Calculate needed memory
 	size_t address_space_byte_count = maxAddress - minAddress;
-	size_t pages = address_space_byte_count / PMM_BLOCK_SIZE;
+	size_t pages = (address_space_byte_count + PMM_BLOCK_SIZE - 1) / PMM_BLOCK_SIZE;
+
+	//Executables linked for fixed addresses claim their part of the static region while they run
+	if(get_elf_header(libinfo->file)->type == HT_EXEC)
+	{
+		if(minAddress < LINKER_STATIC_BASE || maxAddress > LINKER_STATIC_BASE + LINKER_STATIC_SIZE)
+			return -1;
+
+		//Cached data placed there gets dropped to make room
+		if(!pmmAllocRegion(minAddress, STATIC_REGION_BYTES(pages)))
+		{
+			dynamic_linker_drop_images();
+			pagecacheReclaim((size_t)-1);
+
+			if(!pmmAllocRegion(minAddress, STATIC_REGION_BYTES(pages)))
+				return -1;
+		}
+
+		memset((void*)minAddress, 0, pages * PMM_BLOCK_SIZE);
+
+		libinfo->base_address = NULL;
+		libinfo->fixed_address = (void*)minAddress;
+		libinfo->page_count = pages;
+		return 0;
+	}
 
-	//Allocate it
-	void* base = pmmAllocContinuous(pages);
+	//Allocate it zeroed so .bss doesn't need to be cleared
+	//Cached executable images give their memory back if it runs out
+	void* base = pmmAllocContinuousZeroed(pages);
+	if(!base)
+	{
+		dynamic_linker_drop_images();
+		base = pmmAllocContinuousZeroed(pages);
+	}
 
 	//Set vars
 	libinfo->base_address = base;
@@ -100,10 +140,85 @@ static int getPages(libinfo_t* libinfo)
 
 	return base ? 0 : -1;
 }
+//Reads all PT_LOAD segments with one vectored read of the file range they span
+//Gaps between the segments are read into a scratch buffer
+//Returns false if the segments can't be read at once, they have to be read one by one then
+static bool load_segments(libinfo_t* libinfo)
+{
+	struct iovec iov[MAX_LOAD_IOV];
+	int iovcnt = 0;
+	size_t start = 0;
+	size_t end = 0;
+	size_t max_gap = 0;
+
+	//The segments have to be ordered by their file offset without overlapping
+	ELF_program_header_info_t* header = get_elf_program_header_info(libinfo->file);
+	for(uint16_t i = 0; i < header->entry_count; i++)
+	{
+		ELF_program_header_entry_t* current_header = &header->base[i];
+		if(current_header->type != PHT_LOAD || current_header->segment_size == 0)
+			continue;
+
+		if(iovcnt == 0)
+			start = current_header->offset;
+		else if(current_header->offset < end)
+			return false;
+		else if(current_header->offset - end > max_gap)
+			max_gap = current_header->offset - end;
+
+		iovcnt += iovcnt == 0 ? 1 : 2;
+		end = current_header->offset + current_header->segment_size;
+	}
+
+	if(iovcnt == 0 || iovcnt > MAX_LOAD_IOV)
+		return false;
+
+	char* scratch = NULL;
+	if(max_gap && !(scratch = kmalloc(max_gap)))
+		return false;
+
+	//Each segment is read straight into the pages from getPages
+	iovcnt = 0;
+	size_t pos = start;
+	for(uint16_t i = 0; i < header->entry_count; i++)
+	{
+		ELF_program_header_entry_t* current_header = &header->base[i];
+		if(current_header->type != PHT_LOAD || current_header->segment_size == 0)
+			continue;
+
+		if(current_header->offset > pos)
+		{
+			iov[iovcnt].iov_base = scratch;
+			iov[iovcnt++].iov_len = current_header->offset - pos;
+		}
+
+		iov[iovcnt].iov_base = (void*)((size_t)current_header->vaddr + libinfo->base_address);
+		iov[iovcnt++].iov_len = current_header->segment_size;
+		pos = current_header->offset + current_header->segment_size;
+	}
+
+	vfsSeek(libinfo->file->file, start, SEEK_SET);
+	size_t read = vfsReadv(libinfo->file->file, iov, iovcnt);
+
+	kfree(scratch);
+
+	return read == end - start;
+}
 //Checks if the library is position independant
-static bool test_pie(ELF_section_header_info_t* header)
+static bool test_pie(ELF_header_t* header)
+{
+	return header->type == HT_DYN;
+}
+//Checks if the executable runs without the dynamic linker
+//Static executables have neither a dynamic section nor an interpreter
+static bool test_static(ELF_FILE* file)
 {
-	//FIXME: IMPLEMENT
+	ELF_program_header_info_t* header = get_elf_program_header_info(file);
+	for(uint16_t i = 0; i < header->entry_count; i++)
+	{
+		if(header->base[i].type == PHT_DYNAMIC || header->base[i].type == PHT_INTERP)
+			return false;
+	}
 	return true;
 }
 //Checks if the library is already loaded
@@ -131,49 +246,113 @@ int linker_main(FILE* in_stream, FILE* out_stream, FILE* err_stream, FILE* execu
 	stdout = out_stream;
 	stderr = err_stream;
 
+	uint32_t start = getTicks();
+	int returnCode = 0;
+	libinfo_t* libinfo = NULL;
+	bool warm = false;
+	bool static_executable = false;
+	ELF_FILE* file;
+
+	//Start the cached image if the executable didn't change since it was loaded
+	//Only dynamic executables get cached, so the file isn't parsed for a warm launch.
+	//For static executables the lookup misses without touching any library
+	if((libinfo = dynamic_linker_acquire_image(executable)))
+	{
+		warm = true;
+		vfsClose(executable);
+	}
 	//Extend the file to an ELF file
-	ELF_FILE* file = create_elf_file_struct(executable);
-	if(!file)
-		return -1000;
+	else if(!(file = create_elf_file_struct(executable)))
+		returnCode = -1000;
+	else
+	{
+		//Static executables skip the dynamic linker and the image cache
+		static_executable = test_static(file);
 
-	//Extend the ELF_FILE to an library
-	libinfo_t* libinfo = kzalloc(sizeof(libinfo_t));
-	libinfo->file = file;
+		//Extend the ELF_FILE to an library
+		libinfo = kzalloc(sizeof(libinfo_t));
+		libinfo->name = executable->file_desc->name;
+		libinfo->file = file;
 
-	//Process program headers and if it returns with 0 execute the program with the given command line args
-	int returnCode;
-	if(!(returnCode = process_program_header(libinfo)))
+		//Process program headers and keep the relocated executable for the next launch
+		if(!(returnCode = process_program_header(libinfo)))
+		{
+			libinfo->entry_point = get_elf_header(file)->entry_point + libinfo->base_address;
+			if(!static_executable)
+				dynamic_linker_insert_image(libinfo);
+		}
+	}
+
+	//If everything is loaded execute the program with the given command line args
+	if(!returnCode)
 	{
+		uint32_t ticks = getTicks() - start;
+		if(static_executable)
+		{
+			stats.static_launches++;
+			stats.static_ticks += ticks;
+		}
+		else if(warm)
+		{
+			stats.warm_launches++;
+			stats.warm_ticks += ticks;
+		}
+		else
+		{
+			stats.cold_launches++;
+			stats.cold_ticks += ticks;
+		}
+
 		int (*program_entry)(int argc, char *argv[]);
-		program_entry = get_elf_header(file)->entry_point + libinfo->base_address;
+		program_entry = libinfo->entry_point;
+
+		//Give the program its own arena for malloc which gets dropped as a whole on exit
+		arena_t* previousArena = currentArena;
+		currentArena = arenaCreate();
 
 		returnCode = program_entry(argc, argv);
 
 		vfsFlush(stdin);
 		vfsFlush(stdout);
 		vfsFlush(stderr);
+
+		arenaDestroy(currentArena);
+		currentArena = previousArena;
 	}
 
 	//Free memory
 	for(size_t i = loaded_lib_count - 1; i != (size_t)-1; i--)
 	{
-		
-		if(strcmp(LIBINFO_NAME(loaded_libs[i]), "libkernel.so") == 0)
-		{
-			kfree(loaded_libs[i]->string_table_base);
-			kfree(loaded_libs[i]->symbol_table_base);
-		}
+		//Shared libraries stay in memory for the next program
+		if(loaded_libs[i]->resident)
+			dynamic_linker_release_lib(loaded_libs[i]);
 		else
-			pmmFreeContinuous(loaded_libs[i]->base_address, loaded_libs[i]->page_count);
-
-		//Free libinfo
-		LIBINFO_FREE(loaded_libs[i])
+			linker_free_lib(loaded_libs[i]);
 	}
 	loaded_lib_count = 0;
 
 	//return the return code of the application or if the initialization failed of process_program_header
 	return returnCode;
 }
+//Frees a library and the memory it was loaded into
+void linker_free_lib(libinfo_t* libinfo)
+{
+	if(libinfo->fixed_address)
+		pmmFreeRegion((uintptr_t)libinfo->fixed_address, STATIC_REGION_BYTES(libinfo->page_count));
+	else
+		pmmFreeContinuous(libinfo->base_address, libinfo->page_count);
+
+	//Free libinfo, cached images closed their file already
+	if(libinfo->file)
+		dispose_elf_file_struct(libinfo->file);
+	kfree(libinfo);
+}
+//Gets the launch counters
+void linker_get_stats(linker_stats_t* out)
+{
+	*out = stats;
+	out->images = dynamic_linker_image_count();
+}
 //Processes the program header of a library
 //EXCEPTIONS:
 //	- 1: Executable is not position independant
@@ -191,8 +370,8 @@ int process_program_header(libinfo_t* libinfo)
 		return 0;
 	}
 
-	//We can't use not-pie executables
-	if(!test_pie(get_elf_section_header_info(libinfo->file)))
+	//Executables linked for fixed addresses can't be relocated, so they have to be static
+	if(!test_pie(get_elf_header(libinfo->file)) && !test_static(libinfo->file))
 	{
 		//Free the allocated memory
 		LIBINFO_FREE(libinfo)
@@ -210,6 +389,9 @@ int process_program_header(libinfo_t* libinfo)
 	//Dynamic section program header entry
 	ELF_program_header_entry_t* needLinking = NULL;
 
+	//Read the whole image at once if possible
+	bool loaded = load_segments(libinfo);
+
 	//Process each program header entry
 	ELF_program_header_info_t* header = get_elf_program_header_info(libinfo->file);
 	for(uint16_t i = 0; i < header->entry_count; i++)
@@ -219,14 +401,13 @@ int process_program_header(libinfo_t* libinfo)
 		switch(current_header->type)
 		{
 			case PHT_LOAD:
+				//The rest of the segment is already zero because getPages got zeroed pages
+				if(loaded)
+					break;
 				//Load from the specified offset
 				vfsSeek(libinfo->file->file, current_header->offset, SEEK_SET);
 				//Load specified count to our buffer gotten by getPages
 				vfsRead(libinfo->file->file, (void*)((size_t)current_header->vaddr + libinfo->base_address), current_header->segment_size);
-				//Fill rest of buffer with 0
-				uint32_t not_in_file_space = current_header->memory_size - current_header->segment_size;
-				void* not_in_file_space_in_memory_start = (void*)(current_header->segment_size + current_header->vaddr + libinfo->base_address);
-				memset(not_in_file_space_in_memory_start, 0, not_in_file_space);
 				break;
 			case PHT_DYNAMIC:
 				//Save the header of the dynamic section
@@ -240,7 +421,7 @@ int process_program_header(libinfo_t* libinfo)
 				if(!test_demanded_linker(libinfo, current_header))
 				{
 					//Free the allocated memory
-					LIBINFO_FREE(libinfo)
+					linker_free_lib(libinfo);
 					return -3;
 				}
 				break;
@@ -248,18 +429,25 @@ int process_program_header(libinfo_t* libinfo)
 			case PHT_SHLIB:
 			case PHT_PHDR:
 			case PHT_NULL:
+			//Emitted by linkers targeting GNU systems, the pages stay writable anyway
+			case PHT_GNU_STACK:
+			case PHT_GNU_RELRO:
 				//No action needed
 				break;
 			default:
 				//Unknown type
+				linker_free_lib(libinfo);
 				return -4;
 		}
 	}
 
+	//Everything is parsed, the headers stay cached
+	free_elf_head(libinfo->file);
+
 	if(loaded_lib_count == MAX_LOADED_LIBS)
 	{
 		//FIXME: HANDLE OUT OF ARRAY SPACE
-		LIBINFO_FREE(libinfo)
+		linker_free_lib(libinfo);
 		return -4;
 	}
 
@@ -120,4 +120,44 @@ int process_relocation(libinfo_t* libinfo, dynamic_linker_reloc_info_t info)
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
+//Prepares the PLT relocations for lazy binding
+//Slots of symbols in other libraries point back into the PLT, which calls the resolver on the first call
+//EXCEPTIONS:
+//	-1: Unknown/Bad reloc type
+//	-2: Bad relocation entry size
+//	-3: Unable to handle entry
+int process_lazy_relocation(libinfo_t* libinfo, dynamic_linker_reloc_info_t info)
+{
+	//If type if not REL or RELA report error
+	if(info.type != RELOC_REL && info.type != RELOC_RELA)
+		return -1;
+
+	//If the sizes don't match then something is wrong
+	if(	info.entry_size != sizeof(ELF_Rela)
+		&& info.entry_size != sizeof(ELF_Rel))
+		return -2;
+
+	//Loop through the table
+	relocation_entry_t* entry = (relocation_entry_t*)info.address;
+	while((size_t)entry - (size_t)info.address < info.size)
+	{
+		uint32_t* address = RESOLVE_MEM_ADDRESS(libinfo, entry->rel.offset);
+		size_t index = ELF32_R_SYM(entry->rel.info);
+
+		if(ELF32_R_TYPE(entry->rel.info) != R_386_JMP_SLOT)
+			return -3;
+
+		uint32_t compile_time_address = libinfo->symbol_table_base[index].value;
+		if(compile_time_address)
+			//Defined inside the library itself
+			*address = (uint32_t)RESOLVE_MEM_ADDRESS(libinfo, compile_time_address);
+		else
+			//The slot holds the compile time address of the push instruction behind the jump of the PLT entry
+			*address = (uint32_t)RESOLVE_MEM_ADDRESS(libinfo, *address);
+
+		INCREASE_RELOCATION_ENTRY(entry, info.entry_size);
+	}
+
+	return 0;
+}
@@ -31,5 +31,11 @@
 //	-2: Bad relocation entry size
 //	-3: Unable to handle entry
 int process_relocation(libinfo_t* libinfo, dynamic_linker_reloc_info_t info);
+//Prepares the PLT relocations for lazy binding
+//EXCEPTIONS:
+//	-1: Unknown/Bad reloc type
+//	-2: Bad relocation entry size
+//	-3: Unable to handle entry
+int process_lazy_relocation(libinfo_t* libinfo, dynamic_linker_reloc_info_t info);
 
 #endif
\ No newline at end of file
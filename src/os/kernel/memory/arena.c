@@ -0,0 +1,360 @@
+#include <memory/arena.h>
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <memory/pmm.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define ARENA_RUN_BLOCKS 4        // Blocks requested from the PMM for every bump run
+#define ARENA_MIN_CLASS  16       // Payload size of the smallest size class
+#define ARENA_LARGE      0xFFFFFFFF // Size class of allocations owning a dedicated run
+
+// Large allocations that have to move get this much extra capacity (in 1/n of the new size)
+#define ARENA_GROWTH_HINT 2
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// The header in front of every arena allocation
+typedef struct block_t
+{
+	size_t capacity;    // Usable bytes after the header
+	uint32_t sizeClass; // Index into the freelists or ARENA_LARGE
+} block_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+arena_t *currentArena = NULL;
+
+static arena_stats_t stats; // Totals of the destroyed arenas
+
+//------------------------------------------------------------------------------------------
+//				Private function declarations
+//------------------------------------------------------------------------------------------
+
+static inline block_t* header(void *ptr);
+static inline uintptr_t runEnd(arena_run_t *run);
+static inline size_t classCapacity(uint32_t sizeClass);
+
+static int32_t sizeClassOf(size_t size);
+static arena_run_t* findRun(arena_t *arena, const void *ptr, arena_run_t **prev);
+static arena_run_t* allocRun(arena_t *arena, size_t blocks);
+
+static void* allocLarge(arena_t *arena, size_t size);
+static void* allocSmall(arena_t *arena, uint32_t sizeClass);
+static int growLarge(arena_t *arena, block_t *block, size_t size);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+// Get the header of an allocation
+static inline block_t* header(void *ptr)
+{
+	return (block_t*)((uintptr_t)ptr - sizeof(block_t));
+}
+
+// Get address after a run
+static inline uintptr_t runEnd(arena_run_t *run)
+{
+	return (uintptr_t)run + run->blocks * PMM_BLOCK_SIZE;
+}
+
+// Get the payload size of a size class
+static inline size_t classCapacity(uint32_t sizeClass)
+{
+	return (size_t)ARENA_MIN_CLASS << sizeClass;
+}
+
+// Returns the smallest size class holding the size
+// or -1 if it needs a dedicated run
+static int32_t sizeClassOf(size_t size)
+{
+	for (uint32_t i = 0; i < ARENA_CLASS_COUNT; i++)
+	{
+		if (size <= classCapacity(i))
+			return i;
+	}
+
+	return -1;
+}
+
+// Finds the run containing the pointer
+// The run before it in the list is stored in prev if requested
+static arena_run_t* findRun(arena_t *arena, const void *ptr, arena_run_t **prev)
+{
+	arena_run_t *last = NULL;
+
+	for (arena_run_t *run = arena->runs; run; run = run->next)
+	{
+		if ((uintptr_t)ptr > (uintptr_t)run && (uintptr_t)ptr < runEnd(run))
+		{
+			if (prev)
+				*prev = last;
+
+			return run;
+		}
+
+		last = run;
+	}
+
+	return NULL;
+}
+
+// Gets continuous blocks from the PMM and adds them to the arena
+static arena_run_t* allocRun(arena_t *arena, size_t blocks)
+{
+	arena_run_t *run = (arena_run_t*)pmmAllocContinuous(blocks);
+
+	if (!run)
+		return NULL;
+
+	run->blocks = blocks;
+	run->next = arena->runs;
+	arena->runs = run;
+
+	return run;
+}
+
+// Allocations too big for a size class get their own run
+// so they can be handed back to the PMM when freed
+static void* allocLarge(arena_t *arena, size_t size)
+{
+	size_t total = sizeof(arena_run_t) + sizeof(block_t) + size;
+	size_t blocks = (total + PMM_BLOCK_SIZE - 1) / PMM_BLOCK_SIZE;
+
+	arena_run_t *run = allocRun(arena, blocks);
+
+	if (!run)
+		return NULL;
+
+	block_t *block = (block_t*)((uintptr_t)run + sizeof(arena_run_t));
+	block->capacity = blocks * PMM_BLOCK_SIZE - sizeof(arena_run_t) - sizeof(block_t);
+	block->sizeClass = ARENA_LARGE;
+
+	return (void*)((uintptr_t)block + sizeof(block_t));
+}
+
+// Takes a block out of the freelist or bumps a new one
+static void* allocSmall(arena_t *arena, uint32_t sizeClass)
+{
+	// Recycle a freed block of the same class
+	void *ptr = arena->freeLists[sizeClass];
+	if (ptr)
+	{
+		arena->freeLists[sizeClass] = *(void**)ptr;
+		return ptr;
+	}
+
+	size_t needed = sizeof(block_t) + classCapacity(sizeClass);
+
+	// The current run is exhausted. The remainder is left unused
+	if (arena->bumpEnd - arena->bumpPtr < needed)
+	{
+		arena_run_t *run = allocRun(arena, ARENA_RUN_BLOCKS);
+
+		if (!run)
+			return NULL;
+
+		arena->bumpPtr = (uintptr_t)run + sizeof(arena_run_t);
+		arena->bumpEnd = runEnd(run);
+	}
+
+	block_t *block = (block_t*)arena->bumpPtr;
+	block->capacity = classCapacity(sizeClass);
+	block->sizeClass = sizeClass;
+
+	arena->bumpPtr += needed;
+
+	return (void*)((uintptr_t)block + sizeof(block_t));
+}
+
+// Tries to grow a large allocation in place by claiming the blocks after its run
+static int growLarge(arena_t *arena, block_t *block, size_t size)
+{
+	arena_run_t *run = findRun(arena, block, NULL);
+	uintptr_t end = runEnd(run);
+
+	// Rounds to actual blocks automatically
+	size_t blocks = pmmAllocRegion(end, size - block->capacity);
+
+	if (blocks == 0)
+		return 1;
+
+	run->blocks += blocks;
+	block->capacity += blocks * PMM_BLOCK_SIZE;
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Creates a new arena. The arena header lives inside its own first run
+// Returns zero if the system is out of memory
+arena_t* arenaCreate()
+{
+	arena_run_t *run = (arena_run_t*)pmmAllocContinuous(ARENA_RUN_BLOCKS);
+
+	if (!run)
+	{
+		debug_print("[ARENA] Creation failed: Out of memory");
+		return NULL;
+	}
+
+	run->blocks = ARENA_RUN_BLOCKS;
+	run->next = NULL;
+
+	arena_t *arena = (arena_t*)((uintptr_t)run + sizeof(arena_run_t));
+	memset(arena, 0, sizeof(arena_t));
+
+	arena->runs = run;
+	arena->bumpPtr = (uintptr_t)arena + sizeof(arena_t);
+	arena->bumpEnd = runEnd(run);
+
+	return arena;
+}
+
+// Hands every run of the arena back to the PMM
+// The arena itself is gone afterwards
+void arenaDestroy(arena_t *arena)
+{
+	if (!arena)
+		return;
+
+	// Statistics have to be read before the run holding the arena is gone
+	stats.destroyed++;
+	stats.reallocCopied += arena->reallocCopied;
+	stats.reallocSaved += arena->reallocSaved;
+
+	arena_run_t *run = arena->runs;
+
+	while (run)
+	{
+		arena_run_t *next = run->next;
+
+		stats.releasedBlocks += run->blocks;
+		pmmFreeContinuous(run, run->blocks);
+
+		run = next;
+	}
+}
+
+// Allocates the needed space inside the arena
+// Return zero if the system is out of memory
+void* arenaAlloc(arena_t *arena, size_t size)
+{
+	if (!size)
+		return NULL;
+
+	int32_t sizeClass = sizeClassOf(size);
+
+	if (sizeClass < 0)
+		return allocLarge(arena, size);
+
+	return allocSmall(arena, sizeClass);
+}
+
+// Resizes the area. Content is preserved
+// The pointer has to be owned by the arena
+void* arenaRealloc(arena_t *arena, void *ptr, size_t size)
+{
+	if (!ptr)
+		return arenaAlloc(arena, size);
+
+	if (!size)
+	{
+		arenaFree(arena, ptr);
+		return NULL;
+	}
+
+	block_t *block = header(ptr);
+
+	// The block already has enough space
+	if (size <= block->capacity)
+		return ptr;
+
+	// Dedicated runs may be extended into the following blocks.
+	// Only the old contents would have been copied
+	size_t oldCapacity = block->capacity;
+	if (block->sizeClass == ARENA_LARGE && !growLarge(arena, block, size))
+	{
+		arena->reallocSaved += oldCapacity;
+		return ptr;
+	}
+
+	// Leave room for further growth if the allocation ends up in a dedicated run
+	size_t capacity = size;
+	if (sizeClassOf(size) < 0)
+		capacity += size / ARENA_GROWTH_HINT;
+
+	void *newPtr = arenaAlloc(arena, capacity);
+
+	if (!newPtr)
+		return NULL;
+
+	memcpy(newPtr, ptr, block->capacity);
+	arena->reallocCopied += block->capacity;
+	arenaFree(arena, ptr);
+
+	return newPtr;
+}
+
+// Frees the allocation if it belongs to the arena
+// Returns -1 if the pointer is not owned by the arena
+int arenaFree(arena_t *arena, void *ptr)
+{
+	if (!ptr)
+		return 0;
+
+	arena_run_t *prev = NULL;
+	arena_run_t *run = findRun(arena, ptr, &prev);
+
+	if (!run)
+		return -1;
+
+	block_t *block = header(ptr);
+
+	if (block->sizeClass == ARENA_LARGE)
+	{
+		// Unlink and release the dedicated run
+		if (prev)
+			prev->next = run->next;
+		else
+			arena->runs = run->next;
+
+		pmmFreeContinuous(run, run->blocks);
+	}
+	else
+	{
+		*(void**)ptr = arena->freeLists[block->sizeClass];
+		arena->freeLists[block->sizeClass] = ptr;
+	}
+
+	return 0;
+}
+
+// Checks if the pointer lies inside one of the runs of the arena
+int arenaOwns(arena_t *arena, const void *ptr)
+{
+	return findRun(arena, ptr, NULL) != NULL;
+}
+
+// Gets the totals of all destroyed arenas
+void arenaGetStats(arena_stats_t *out)
+{
+	*out = stats;
+}
@@ -16,6 +16,16 @@
 
 #define GROUP_SIZE 4 // The minimum amount of blocks to optimize for to reduce runtime
 
+// Growing allocations that have to move get this much extra capacity (in 1/n of the new size)
+// so that repeated small growth steps can be done in place afterwards
+#define REALLOC_GROWTH_HINT 2
+
+// Zeroed allocations of at least this size get a fresh chunk of pre-zeroed blocks
+#define ZEROED_CHUNK_SIZE (2 * PMM_BLOCK_SIZE)
+
+// Address the currently executing function returns to
+#define CALLER() ((uintptr_t)__builtin_return_address(0))
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
@@ -27,7 +37,8 @@ typedef struct allocation_t
 	struct allocation_t *prev;
 	struct allocation_t *next;
 
-	size_t size; // Size of allocation in bytes
+	size_t size;      // Size of allocation in bytes
+	uintptr_t caller; // Return address into the function that allocated it
 } allocation_t;
 
 // The header at the beginning of a heap chunk
@@ -52,6 +63,15 @@ typedef struct chunk_t
 // Pointer to the initial block of the heap
 static chunk_t *heap;
 
+// Profiling counters
+static heap_stats_t stats;
+static heap_caller_t callers[HEAP_MAX_CALLERS];
+static size_t callerCount = 0;
+
+// Receives every public heap operation while set
+static heap_trace_hook_t traceHook = NULL;
+static bool traceMuted = false; // Hides the operations krealloc is built of
+
 //------------------------------------------------------------------------------------------
 //				Private function declarations
 //------------------------------------------------------------------------------------------
@@ -64,7 +84,7 @@ static inline uintptr_t chunkEnd(chunk_t *chunk);
 
 static void tryLinkChunks(chunk_t *before, chunk_t *after);
 static int tryResizeChunk(chunk_t *chunk, size_t size);
-static chunk_t* createNewChunk(size_t size);
+static chunk_t* createNewChunk(size_t size, bool zeroed);
 static chunk_t* extendHeap(size_t size);
 
 static void findLargestFree(chunk_t *chunk);
@@ -73,7 +93,19 @@ static void optimizeChunk(chunk_t *chunk);
 static allocation_t* createAllocation(chunk_t *chunk, size_t size);
 static void removeAllocation(chunk_t *chunk, allocation_t *allocation);
 
+static int resizeInPlace(chunk_t *chunk, allocation_t *allocation, size_t size);
+
 static allocation_t* allocate(size_t size);
+static void* allocateFrom(size_t size, uintptr_t caller);
+static void* allocateZeroedFrom(size_t size, uintptr_t caller);
+
+static heap_caller_t* findCaller(uintptr_t caller);
+static void trackAllocation(allocation_t *alloc);
+static void trackFree(allocation_t *alloc);
+static void trackResize(allocation_t *alloc, size_t size);
+static inline void trace(char op, const void *ptr, size_t size, const void *old);
+
+static void* reallocate(void *ptr, size_t size, uintptr_t caller);
 
 //------------------------------------------------------------------------------------------
 //				Private function implementations
@@ -195,11 +227,16 @@ static int tryResizeChunk(chunk_t *chunk, size_t size)
 	}
 
 	// Find end of table
-	allocation_t *end = chunk->table;
-	while(end->next)
-		end = end->next;
+	uintptr_t endPtr = (uintptr_t)chunk + sizeof(chunk_t);
+	if (chunk->table)
+	{
+		allocation_t *end = chunk->table;
+		while(end->next)
+			end = end->next;
+
+		endPtr = allocEnd(end);
+	}
 
-	uintptr_t endPtr = allocEnd(end);
 	uintptr_t blockEnd = chunkEnd(chunk);
 
 	if (endPtr + size > size) // Prevent integer overflow
@@ -232,14 +269,15 @@ static int tryResizeChunk(chunk_t *chunk, size_t size)
 }
 
 // Creates a new chunk
-static chunk_t* createNewChunk(size_t size)
+// The space after the chunk header is zero if zeroed is set
+static chunk_t* createNewChunk(size_t size, bool zeroed)
 {
 	// Calculate number of blocks by rounding up
 	size_t chunkSize = ((size + sizeof(chunk_t)) + PMM_BLOCK_SIZE - 1) & -PMM_BLOCK_SIZE;
 	size_t blocks = chunkSize / PMM_BLOCK_SIZE;
 
 	// Allocate necessary blocks
-	void *addr = pmmAllocContinuous(blocks);
+	void *addr = zeroed ? pmmAllocContinuousZeroed(blocks) : pmmAllocContinuous(blocks);
 
 	if (!addr)
 		return 0; // Out of memory
@@ -269,6 +307,7 @@ static chunk_t* createNewChunk(size_t size)
 				moveHeap(newChunk);
 
 			current->prev = newChunk;
+			break;
 		}
 		else if (current->next == NULL)
 		{
@@ -296,7 +335,7 @@ static chunk_t* extendHeap(size_t size)
 	}
 
 	// Create a new chunk
-	return createNewChunk(size);
+	return createNewChunk(size, false);
 }
 
 static void findLargestFree(chunk_t *chunk)
@@ -502,7 +541,7 @@ static void optimizeChunk(chunk_t *chunk)
 static allocation_t* createAllocation(chunk_t *chunk, size_t size)
 {
 	// Chunk is too small to hold allocation
-	if (chunk->blocks * PMM_BLOCK_SIZE - sizeof(chunk_t) < size)
+	if (chunk->blocks * PMM_BLOCK_SIZE - sizeof(chunk_t) < size + sizeof(allocation_t))
 		return 0;
 
 	allocation_t *alloc = NULL;
@@ -656,6 +695,51 @@ static void removeAllocation(chunk_t *chunk, allocation_t *allocation)
 	optimizeChunk(chunk);
 }
 
+// Tries to resize an allocation without moving it.
+// Grows into the free space behind the allocation or, for the last allocation
+// of a chunk, into the blocks directly after the chunk
+static int resizeInPlace(chunk_t *chunk, allocation_t *allocation, size_t size)
+{
+	uintptr_t limit = allocation->next ? (uintptr_t)allocation->next : chunkEnd(chunk);
+	uintptr_t needed = ptr(allocation) + size;
+	size_t oldSpace = limit - allocEnd(allocation);
+
+	if (needed > limit)
+	{
+		// Only the last allocation borders on unused blocks
+		if (allocation->next)
+			return 1;
+
+		// Rounds to actual blocks automatically
+		size_t blocks = pmmAllocRegion(limit, needed - limit);
+
+		if (blocks == 0)
+			return 1;
+
+		chunk->blocks += blocks;
+		limit = chunkEnd(chunk);
+
+		debug_printf("[HEAP] Extended chunk @ %p upwards to %u pages", (void*)chunk, chunk->blocks);
+	}
+
+	trackResize(allocation, size);
+	allocation->size = size;
+
+	// Update the largest free area
+	size_t newSpace = limit - allocEnd(allocation);
+
+	if (newSpace > chunk->largestFree)
+		chunk->largestFree = newSpace;
+	else if (oldSpace == chunk->largestFree && newSpace < oldSpace)
+		findLargestFree(chunk);
+
+	// Try to link together adjacent chunks
+	if (!allocation->next)
+		tryLinkChunks(chunk, chunk->next);
+
+	return 0;
+}
+
 // Tries to allocate the amount of bytes
 // If there is no space in the current heap the heap will be extended accordingly
 static allocation_t* allocate(size_t size)
@@ -685,39 +769,136 @@ static allocation_t* allocate(size_t size)
 	return createAllocation(newChunk, size);
 }
 
-//------------------------------------------------------------------------------------------
-//				Public function implementations
-//------------------------------------------------------------------------------------------
-
-// Allocates the neded space
-// Return zero if the system is out of memory
-void* kmalloc(size_t size)
+// Allocates the space and records it for the given call site
+static void* allocateFrom(size_t size, uintptr_t caller)
 {
 	allocation_t *alloc = allocate(size);
-	
+
 	if (!alloc)
+	{
+		stats.failed++;
 		debug_print("Allocation failed: Out of memory");
+		return NULL;
+	}
+
+	alloc->caller = caller;
+	trackAllocation(alloc);
 
 	return (void*)ptr(alloc);
 }
 
-// Allocates the needed space and memsets it to zero
-void* kzalloc(size_t size)
+// Allocates zeroed space. Big allocations get a fresh chunk out of
+// pre-zeroed blocks so they don't have to be cleared here
+static void* allocateZeroedFrom(size_t size, uintptr_t caller)
 {
-	void* alloc = kmalloc(size);
-	
+	if (size >= ZEROED_CHUNK_SIZE)
+	{
+		chunk_t *chunk = createNewChunk(size + sizeof(allocation_t), true);
+
+		if (chunk)
+		{
+			if (!heap) // Empty heap
+			{
+				heap = chunk;
+				debug_printf("[HEAP] Created heap @ %p", (void*)heap);
+			}
+
+			allocation_t *alloc = createAllocation(chunk, size);
+
+			alloc->caller = caller;
+			trackAllocation(alloc);
+
+			return (void*)ptr(alloc);
+		}
+	}
+
+	void* alloc = allocateFrom(size, caller);
+
 	if (alloc)
 		memset(alloc, 0, size);
 
 	return alloc;
 }
 
+// Finds the statistics entry of a call site and creates it if needed
+// If the table is full the last entry collects all remaining call sites
+static heap_caller_t* findCaller(uintptr_t caller)
+{
+	for (size_t i = 0; i < callerCount; i++)
+	{
+		if (callers[i].caller == caller)
+			return &callers[i];
+	}
+
+	if (callerCount == HEAP_MAX_CALLERS)
+		return &callers[HEAP_MAX_CALLERS - 1];
+
+	heap_caller_t *entry = &callers[callerCount++];
+	entry->caller = callerCount == HEAP_MAX_CALLERS ? 0 : caller;
+
+	return entry;
+}
+
+// Adds a new allocation to the statistics
+static void trackAllocation(allocation_t *alloc)
+{
+	stats.allocations++;
+	stats.liveObjects++;
+	stats.liveBytes += alloc->size;
+
+	if (stats.liveBytes > stats.peakBytes)
+		stats.peakBytes = stats.liveBytes;
+
+	// Bucket 0 holds everything up to 16 bytes, every following bucket doubles the size
+	size_t bucket = 0;
+	for (size_t limit = 16; bucket < HEAP_HISTOGRAM_SIZE - 1 && alloc->size > limit; limit <<= 1)
+		bucket++;
+	stats.histogram[bucket]++;
+
+	heap_caller_t *entry = findCaller(alloc->caller);
+	entry->allocations++;
+	entry->liveObjects++;
+	entry->liveBytes += alloc->size;
+}
+
+// Removes a freed allocation from the statistics
+static void trackFree(allocation_t *alloc)
+{
+	stats.frees++;
+	stats.liveObjects--;
+	stats.liveBytes -= alloc->size;
+
+	heap_caller_t *entry = findCaller(alloc->caller);
+	entry->liveObjects--;
+	entry->liveBytes -= alloc->size;
+}
+
+// Accounts for an allocation changing its size in place
+static void trackResize(allocation_t *alloc, size_t size)
+{
+	heap_caller_t *entry = findCaller(alloc->caller);
+
+	stats.liveBytes = stats.liveBytes - alloc->size + size;
+	entry->liveBytes = entry->liveBytes - alloc->size + size;
+
+	if (stats.liveBytes > stats.peakBytes)
+		stats.peakBytes = stats.liveBytes;
+}
+
+// Reports an operation to the trace hook
+static inline void trace(char op, const void *ptr, size_t size, const void *old)
+{
+	if (traceHook && !traceMuted)
+		traceHook(op, (uintptr_t)ptr, size, (uintptr_t)old);
+}
+
 //Resizes the area. Content is preserved
-void* krealloc(void* ptr, size_t size)
+//Grows and shrinks in place if possible and only copies as a last resort
+static void* reallocate(void* ptr, size_t size, uintptr_t caller)
 {
 	//If the pointer is undefined krealloc behaves as kmalloc
 	if(!ptr)
-		return kmalloc(size);
+		return allocateFrom(size, caller);
 	//If the size is zero krealloc behaves as kfree
 	if(!size)
 	{
@@ -725,8 +906,9 @@ void* krealloc(void* ptr, size_t size)
 		return NULL;
 	}
 
-	//Search the allocation
+	//Search the allocation and its chunk
 	allocation_t* allocation = NULL;
+	chunk_t* owner = NULL;
 	for (chunk_t *chunk = heap; chunk != NULL && allocation == NULL; chunk = chunk->next)
 	{
 		for (allocation_t *alloc = chunk->table; alloc != NULL && allocation == NULL; alloc = alloc->next)
@@ -734,47 +916,100 @@ void* krealloc(void* ptr, size_t size)
 			if ((uintptr_t)alloc + sizeof(allocation_t) == (uintptr_t)ptr)
 			{
 				allocation = alloc;
+				owner = chunk;
 			}
 		}
 	}
 	//If we found nothing just allocate new space
 	if(allocation == NULL)
-		return kmalloc(size);
+		return allocateFrom(size, caller);
 
 	//If the size is smaller just cut a part off
+	//Small cuts keep the capacity for a following growth
 	if(size <= allocation->size)
 	{
-		allocation->size = size;
+		if(size <= allocation->size / 2)
+		{
+			resizeInPlace(owner, allocation, size);
+			optimizeChunk(owner);
+		}
 		return ptr;
 	}
-	//Otherwise we need a new allocation
-	else
+
+	//Try to grow into the space after the allocation
+	size_t oldSize = allocation->size;
+	if(!resizeInPlace(owner, allocation, size))
 	{
-		//Get new larger memory space
-		void* newPtr = kmalloc(size);
-		//Copy old content to the new allocation
-		memcpy(newPtr, ptr, allocation->size);
-		//Free old allocation
-		kfree(ptr);
-		//Return new allocation
-		return newPtr;
+		stats.reallocSaved += oldSize;
+		return ptr;
 	}
+
+	//Otherwise we need a new allocation with some room to grow
+	void* newPtr = allocateFrom(size + size / REALLOC_GROWTH_HINT, caller);
+	if(!newPtr)
+		newPtr = allocateFrom(size, caller);
+	if(!newPtr)
+		return NULL;
+
+	//Copy old content to the new allocation
+	memcpy(newPtr, ptr, oldSize);
+	stats.reallocCopied += oldSize;
+	//Free old allocation
+	kfree(ptr);
+	//Return new allocation
+	return newPtr;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Allocates the neded space
+// Return zero if the system is out of memory
+void* kmalloc(size_t size)
+{
+	void* alloc = allocateFrom(size, CALLER());
+	trace(HEAP_TRACE_ALLOC, alloc, size, NULL);
+
+	return alloc;
+}
+
+// Allocates the needed space and memsets it to zero
+void* kzalloc(size_t size)
+{
+	void* alloc = allocateZeroedFrom(size, CALLER());
+	trace(HEAP_TRACE_ZALLOC, alloc, size, NULL);
+
+	return alloc;
+}
+
+//Resizes the area. Content is preserved
+void* krealloc(void* ptr, size_t size)
+{
+	traceMuted = true;
+	void* newPtr = reallocate(ptr, size, CALLER());
+	traceMuted = false;
+
+	trace(HEAP_TRACE_REALLOC, newPtr, size, ptr);
+
+	return newPtr;
 }
 
 // Allocates space for an array
 void* kmalloc_array(size_t n, size_t size)
 {
 	size_t actualSize = n * size;
-	return kmalloc(actualSize);
+	void* alloc = allocateFrom(actualSize, CALLER());
+	trace(HEAP_TRACE_ALLOC, alloc, actualSize, NULL);
+
+	return alloc;
 }
 
 // Allocates space for an array and memsets it to zero
 void* kcalloc(size_t n, size_t size)
 {
-	void* alloc = kmalloc_array(n, size);
-
-	if (alloc)
-		memset(alloc, 0, n * size);
+	void* alloc = allocateZeroedFrom(n * size, CALLER());
+	trace(HEAP_TRACE_ZALLOC, alloc, n * size, NULL);
 
 	return alloc;
 }
@@ -783,7 +1018,8 @@ void* kcalloc(size_t n, size_t size)
 char* kstrdup(const char *s)
 {
 	size_t len = strlen(s) + 1; // Include null-byte
-	void* alloc = kmalloc(len);
+	void* alloc = allocateFrom(len, CALLER());
+	trace(HEAP_TRACE_ALLOC, alloc, len, NULL);
 
 	if (alloc)
 		memcpy(alloc, (void*)s, len);
@@ -800,7 +1036,8 @@ char* kstrndup(const char *s, size_t max)
 	if (len > max)
 		len = max;
 	
-	char* alloc = (char*)kmalloc(len + 1);
+	char* alloc = (char*)allocateFrom(len + 1, CALLER());
+	trace(HEAP_TRACE_ALLOC, alloc, len + 1, NULL);
 	
 	if (alloc)
 	{
@@ -815,7 +1052,8 @@ char* kstrndup(const char *s, size_t max)
 // the memory from the source
 void* kmemdup(const void *src, size_t len)
 {
-	void *alloc = kmalloc(len);
+	void *alloc = allocateFrom(len, CALLER());
+	trace(HEAP_TRACE_ALLOC, alloc, len, NULL);
 
 	if (alloc)
 		memcpy(alloc, src, len);
@@ -832,9 +1070,111 @@ void kfree(const void *objp)
 		{
 			if ((uintptr_t)alloc + sizeof(allocation_t) == (uintptr_t)objp)
 			{
+				trace(HEAP_TRACE_FREE, objp, 0, NULL);
+				trackFree(alloc);
 				removeAllocation(chunk, alloc);
 				return;
 			}
 		}
 	}
 }
+
+// Sets the function receiving every heap operation
+// NULL disables tracing
+void heapSetTraceHook(heap_trace_hook_t hook)
+{
+	traceHook = hook;
+}
+
+// Fills in the heap counters and walks the heap for the chunk statistics
+void heapGetStats(heap_stats_t *out)
+{
+	*out = stats;
+
+	out->chunks = 0;
+	out->chunkBytes = 0;
+	out->freeBytes = 0;
+	out->largestFree = 0;
+
+	for (chunk_t *chunk = heap; chunk != NULL; chunk = chunk->next)
+	{
+		size_t bytes = chunk->blocks * PMM_BLOCK_SIZE;
+		size_t used = sizeof(chunk_t);
+		for (allocation_t *alloc = chunk->table; alloc != NULL; alloc = alloc->next)
+			used += sizeof(allocation_t) + alloc->size;
+
+		findLargestFree(chunk);
+
+		out->chunks++;
+		out->chunkBytes += bytes;
+		out->freeBytes += bytes - used;
+
+		if (chunk->largestFree > out->largestFree)
+			out->largestFree = chunk->largestFree;
+	}
+
+	// Free memory that can't be used for one big allocation
+	out->fragmentation = out->freeBytes ? 100 - (uint32_t)((uint64_t)out->largestFree * 100 / out->freeBytes) : 0;
+}
+
+// Fills in the utilisation of up to max chunks
+// Returns the total number of chunks
+size_t heapGetChunks(heap_chunk_info_t *chunks, size_t max)
+{
+	size_t count = 0;
+
+	for (chunk_t *chunk = heap; chunk != NULL; chunk = chunk->next, count++)
+	{
+		if (count >= max)
+			continue;
+
+		heap_chunk_info_t *info = &chunks[count];
+		info->address = (uintptr_t)chunk;
+		info->blocks = chunk->blocks;
+		info->allocations = 0;
+		info->usedBytes = 0;
+
+		for (allocation_t *alloc = chunk->table; alloc != NULL; alloc = alloc->next)
+		{
+			info->allocations++;
+			info->usedBytes += sizeof(allocation_t) + alloc->size;
+		}
+
+		findLargestFree(chunk);
+		info->largestFree = chunk->largestFree;
+	}
+
+	return count;
+}
+
+// Copies the statistics of up to max call sites sorted by live bytes
+// Returns the number of entries copied
+size_t heapGetCallers(heap_caller_t *out, size_t max)
+{
+	size_t count = callerCount < max ? callerCount : max;
+	bool taken[HEAP_MAX_CALLERS] = { false };
+
+	// Selection of the biggest remaining entry
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t biggest = 0;
+		bool found = false;
+
+		for (size_t j = 0; j < callerCount; j++)
+		{
+			if (taken[j])
+				continue;
+
+			if (!found || callers[j].liveBytes > callers[biggest].liveBytes)
+			{
+				biggest = j;
+				found = true;
+			}
+		}
+
+		taken[biggest] = true;
+		out[i] = callers[biggest];
+	}
+
+	return count;
+}
@@ -44,20 +44,35 @@ extern uintptr_t _end, _start; // Include linker variables for kernel size
 static uint32_t memorySize = 0; // Size of memory
 static uint32_t usedBlocks = 0; // Used block count
 static uint32_t maxBlocks = 0;  // Max block count
+static uint32_t peakBlocks = 0; // Highest used block count after initialization
 static uint32_t *memoryMap = 0; // Holds the block bitmap
 
+// Bitmap of free blocks known to contain only zeros
+// A set bit implies the block is free. Allocating a block clears its bit
+static uint32_t *zeroMap = 0;
+static uint32_t zeroedBlocks = 0; // Number of set bits in zeroMap
+
+static pmm_reclaim_t reclaimHandler = NULL; // Asked for memory when an allocation fails
+static bool reclaiming = false;             // The handler may allocate itself
+
 //------------------------------------------------------------------------------------------
 //				Private function declarations
 //------------------------------------------------------------------------------------------
 
 static inline uint32_t freeBlockCount();
+static inline void updatePeak();
 
 static inline void setBit(int32_t bit);
 static inline void clearBit(int32_t bit);
 static inline bool testBit(int32_t bit);
 
+static inline bool testZero(int32_t bit);
+
 static int32_t firstFreeBlock();
 static int32_t firstFreeContinuous(size_t size);
+static int32_t findContinuous(size_t size);
+
+static bool reclaim(size_t blocks);
 
 //------------------------------------------------------------------------------------------
 //				Private function implementations
@@ -69,10 +84,24 @@ static inline uint32_t freeBlockCount()
 	return maxBlocks - usedBlocks;
 }
 
+// Remembers the highest block usage
+static inline void updatePeak()
+{
+	if (usedBlocks > peakBlocks)
+		peakBlocks = usedBlocks;
+}
+
 // Sets a bit inside the bitmap
+// The block is not known to be zeroed anymore
 static inline void setBit(int32_t bit)
 {
 	memoryMap[bit / 32] |= (1 << (bit % 32));
+
+	if (testZero(bit))
+	{
+		zeroMap[bit / 32] &= ~(1 << (bit % 32));
+		zeroedBlocks--;
+	}
 }
 
 // Clears a bit inside the bitmap
@@ -87,6 +116,12 @@ static inline bool testBit(int32_t bit)
 	return memoryMap[bit / 32] & (1 << (bit % 32));
 }
 
+// Checks if the block is free and known to be zeroed
+static inline bool testZero(int32_t bit)
+{
+	return zeroMap[bit / 32] & (1 << (bit % 32));
+}
+
 static int32_t firstFreeBlock()
 {
 	for (uint32_t i = 0; i < maxBlocks / 32; i++)
@@ -129,7 +164,7 @@ static int32_t firstFreeContinuous(size_t size)
 			if (memoryMap[i] & bit)
 				continue;
 
-			int start = i * 32 + bit;
+			int start = i * 32 + j;
 
 			// Check if the needed amount of blocks is free
 			bool free = true;
@@ -151,6 +186,31 @@ static int32_t firstFreeContinuous(size_t size)
 	return -1;
 }
 
+// Finds a continuous run of free blocks, memory gets reclaimed if there is none
+static int32_t findContinuous(size_t size)
+{
+	int32_t block = freeBlockCount() < size ? -1 : firstFreeContinuous(size);
+
+	while (block == -1 && reclaim(size))
+		block = freeBlockCount() < size ? -1 : firstFreeContinuous(size);
+
+	return block;
+}
+
+// Asks the reclaim handler to free blocks
+// Returns false if nothing was freed
+static bool reclaim(size_t blocks)
+{
+	if (!reclaimHandler || reclaiming)
+		return false;
+
+	reclaiming = true;
+	size_t freed = reclaimHandler(blocks);
+	reclaiming = false;
+
+	return freed > 0;
+}
+
 //------------------------------------------------------------------------------------------
 //				Public function implementations
 //------------------------------------------------------------------------------------------
@@ -178,6 +238,10 @@ int initPMM(multiboot_info_t *header)
 	memoryMap = (uint32_t*)&_end;
 	maxBlocks = (memorySize * 1024) / PMM_BLOCK_SIZE;
 
+	// Zero map goes directly after the memory map
+	zeroMap = memoryMap + maxBlocks / 32;
+	memset(zeroMap, 0, maxBlocks / 8);
+
 	// Initially all memory is used
 	usedBlocks = maxBlocks;
 	memset(memoryMap, 0xFF, maxBlocks / 8); // 8 blocks per byte
@@ -213,8 +277,8 @@ int initPMM(multiboot_info_t *header)
 		region = (multiboot_mmap_entry_t*)((uintptr_t)(region) + region->size + sizeof(region->size));
 	}
 
-	// Declare kernel and bitmap as used
-	pmmAllocRegion((uintptr_t)&_start, (size_t)((&_end - &_start) + maxBlocks / 8));
+	// Declare kernel and bitmaps as used
+	pmmAllocRegion((uintptr_t)&_start, (size_t)((&_end - &_start) + 2 * (maxBlocks / 8)));
 	
 	// Allocate first block holding original IVT and BIOS data
 	pmmAllocRegion(0, PMM_BLOCK_SIZE); 
@@ -222,6 +286,8 @@ int initPMM(multiboot_info_t *header)
 	debug_set_color(0xF, 0x0);
 	debug_printf("Used blocks: %u   Free Blocks: %u", usedBlocks, freeBlockCount());
 
+	peakBlocks = usedBlocks;
+
 	return 0;
 }
 
@@ -234,6 +300,10 @@ int pmmAllocRegion(uintptr_t base, size_t size)
 	int block = base / PMM_BLOCK_SIZE;
 	int count = (size + PMM_BLOCK_SIZE - 1) / PMM_BLOCK_SIZE;
 
+	// Region lies outside of the bitmap
+	if ((uint32_t)(block + count) >= maxBlocks)
+		return 0;
+
 	// Check neccesary bits
 	bool free = true;
 	for (int i = 0; i <= count; i++)
@@ -255,6 +325,8 @@ int pmmAllocRegion(uintptr_t base, size_t size)
 	while(count-- >= 0)
 		setBit(block++);
 
+	updatePeak();
+
 	// Return number of blocks allocated
 	return originalCount + 1;
 }
@@ -280,15 +352,16 @@ int pmmFreeRegion(uintptr_t base, size_t size)
 // Allocates one block an returns its address
 void* pmmAlloc()
 {
-	if (freeBlockCount() == 0)
-		return 0;
+	int block = freeBlockCount() == 0 ? -1 : firstFreeBlock();
+	while (block == -1 && reclaim(1))
+		block = freeBlockCount() == 0 ? -1 : firstFreeBlock();
 
-	int block = firstFreeBlock();
 	if (block == -1)
 		return 0;
 
 	setBit(block);
 	usedBlocks++;
+	updatePeak();
 
 	uintptr_t address = block * PMM_BLOCK_SIZE;
 
@@ -307,10 +380,7 @@ void pmmFree(void* ptr)
 // Allocates a continuous set of blocks
 void* pmmAllocContinuous(size_t size)
 {
-	if (freeBlockCount() < size)
-		return 0;
-
-	int block = firstFreeContinuous(size);
+	int block = findContinuous(size);
 	if (block == -1)
 		return 0;
 
@@ -318,6 +388,7 @@ void* pmmAllocContinuous(size_t size)
 		setBit(block + i);
 
 	usedBlocks += size;
+	updatePeak();
 
 	uintptr_t addr = block * PMM_BLOCK_SIZE;
 	return (void*)addr;
@@ -333,3 +404,93 @@ void pmmFreeContinuous(void* ptr, size_t size)
 
 	usedBlocks -= size;
 }
+
+// Allocates a continuous set of blocks filled with zeros
+// Only the blocks that were not zeroed while idle get cleared
+void* pmmAllocContinuousZeroed(size_t size)
+{
+	int block = findContinuous(size);
+	if (block == -1)
+		return 0;
+
+	for (uint32_t i = 0; i < size; i++)
+	{
+		bool zeroed = testZero(block + i);
+
+		setBit(block + i);
+
+		if (!zeroed)
+			memset((void*)(uintptr_t)((block + i) * PMM_BLOCK_SIZE), 0, PMM_BLOCK_SIZE);
+	}
+
+	usedBlocks += size;
+	updatePeak();
+
+	uintptr_t addr = block * PMM_BLOCK_SIZE;
+	return (void*)addr;
+}
+
+// Zeroes up to count free blocks for later zeroed allocations
+// Meant to be called while the system is idle
+// Returns the number of blocks zeroed
+size_t pmmZeroIdle(size_t count)
+{
+	size_t zeroed = 0;
+
+	// The lowest free blocks are the ones allocated next
+	for (uint32_t i = 0; i < maxBlocks / 32 && zeroed < count && zeroedBlocks < PMM_ZERO_POOL_SIZE; i++)
+	{
+		// Is every block of the chunk used or already zeroed?
+		if ((memoryMap[i] | zeroMap[i]) == 0xFFFFFFFF)
+			continue;
+
+		for (int j = 0; j < 32 && zeroed < count; j++)
+		{
+			int32_t bit = i * 32 + j;
+
+			if (testBit(bit) || testZero(bit))
+				continue;
+
+			// Claim the block while clearing it so it can't be handed out in between
+			setBit(bit);
+			memset((void*)(uintptr_t)(bit * PMM_BLOCK_SIZE), 0, PMM_BLOCK_SIZE);
+			clearBit(bit);
+
+			zeroMap[i] |= (1 << j);
+			zeroedBlocks++;
+			zeroed++;
+		}
+	}
+
+	return zeroed;
+}
+
+// Sets the handler asked for memory when an allocation can't be served
+void pmmSetReclaim(pmm_reclaim_t reclaim)
+{
+	reclaimHandler = reclaim;
+}
+
+// Fills in the current block usage
+void pmmGetStats(pmm_stats_t *stats)
+{
+	stats->totalBlocks = maxBlocks;
+	stats->usedBlocks = usedBlocks;
+	stats->peakUsedBlocks = peakBlocks;
+	stats->zeroedBlocks = zeroedBlocks;
+
+	// Find the longest run of free blocks
+	size_t run = 0;
+	stats->largestFreeRun = 0;
+	for (uint32_t i = 0; i < maxBlocks; i++)
+	{
+		if (testBit(i))
+		{
+			run = 0;
+			continue;
+		}
+
+		if (++run > stats->largestFreeRun)
+			stats->largestFreeRun = run;
+	}
+}
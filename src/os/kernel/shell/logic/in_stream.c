@@ -2,6 +2,7 @@
 
 #include <vfs/vfs.h>
 #include <memory/heap.h>
+#include <memory/pmm.h>
 #include <keyboard.h>
 
 #include <limits.h>
@@ -47,8 +48,9 @@ static size_t shell_in_shell_read(file_desc_t *node, size_t offset, size_t size,
 	if(size != 1)
 		return 0;
 
-	//If we don't have input wait
-	while (!shell_in_bufcount);
+	//If we don't have input wait and use the time to refill the zeroed page pool
+	while (!shell_in_bufcount)
+		pmmZeroIdle(1);
 
 	//Read from the buffer and increase to the next char
 	char character = shell_in_buffer[shell_in_bufbase++];
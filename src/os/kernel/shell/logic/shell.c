@@ -7,14 +7,24 @@
 #include <shell/out_stream.h>
 #include <ld-owos/ld-owos.h>
 #include <memory/heap.h>
+#include <memory/pmm.h>
+#include <memory/arena.h>
 #include <hal/cpu.h>
 #include <vfs/vfs.h>
+#include <vfs/pagecache.h>
 
 #include <stdnoreturn.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <string.h>
+#include <stdio.h>
 #include <debug.h>
 
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+#define SHELL_HEAPSTAT_ROWS 8	//Rows printed for the chunk and caller tables of heapstat
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
@@ -30,30 +40,95 @@ static char* buffer;
 static size_t buffer_index;
 static size_t shell_line_index;
 
+static bool heap_tracing = false;
+
 //------------------------------------------------------------------------------------------
 //				Private Function Declaration
 //------------------------------------------------------------------------------------------
 static void shell_handle_input();
+static void shell_run_stage(const char* input, size_t size, FILE* pipe_in, FILE* pipe_out);
 static void shell_handle_input_normal_char(char c);
 static bool shell_handle_input_char(char c);
 static bool shell_check_intern_program(const char* name);
 static int shell_handle_intern_program(FILE* in_stream, FILE* out_stream, FILE* err_stream, const char* executable, int argc, char *argv[]);
+static void shell_printf(FILE* stream, const char* format, ...);
+static int shell_print_heap_stats(FILE* out_stream);
+static void shell_heap_trace(char op, uintptr_t ptr, size_t size, uintptr_t old);
 
 //------------------------------------------------------------------------------------------
 //				Private Function
 //------------------------------------------------------------------------------------------
+//Splits the input at every unquoted '|' and runs the commands one after the other.
+//Each command writes into a pipe which is read by the next one
 static void shell_handle_input()
+{
+	//Read end of the pipe filled by the previous command
+	FILE* pipe_in = NULL;
+
+	bool is_quotation_mark = false;
+	bool is_escaped = false;
+	size_t start = 0;
+
+	for(size_t i = 0; i <= buffer_index; i++)
+	{
+		if(i < buffer_index)
+		{
+			char c = buffer[i];
+			if(is_escaped)
+			{
+				is_escaped = false;
+				continue;
+			}
+			if(c == '\\')
+				is_escaped = true;
+			else if(c == '"')
+				is_quotation_mark = !is_quotation_mark;
+
+			if(c != '|' || is_quotation_mark)
+				continue;
+		}
+
+		//Every command but the last one writes into a new pipe
+		FILE* pipe_out = NULL;
+		FILE* next_in = NULL;
+		if(i < buffer_index && vfsPipe(&next_in, &pipe_out) != 0)
+		{
+			FILE* err_stream = shell_out_stream_get();
+			vfsWrite(err_stream, "Couldn't create pipe", 20);
+			vfsFlush(err_stream);
+			returnCode = -1;
+			break;
+		}
+
+		shell_run_stage(&buffer[start], i - start, pipe_in, pipe_out);
+
+		//Closing the write end lets the next command read up to EOF
+		if(pipe_in)
+			vfsClose(pipe_in);
+		if(pipe_out)
+			vfsClose(pipe_out);
+
+		pipe_in = next_in;
+		start = i + 1;
+	}
+
+	if(pipe_in)
+		vfsClose(pipe_in);
+}
+
+//Runs one command of the input. The pipe ends replace the shell streams if they are set
+static void shell_run_stage(const char* input, size_t size, FILE* pipe_in, FILE* pipe_out)
 {
 	//Argument count
 	int argc = 0;
 	//Arguments
 	char** args = NULL;
 	//Input stream
-	FILE* in_stream = NULL;
+	FILE* in_stream = pipe_in;
 	//Delete input stream
 	bool del_in_stream = false;
 	//Output stream
-	FILE* out_stream = NULL;
+	FILE* out_stream = pipe_out;
 	//Delete output stream
 	bool del_out_stream = false;
 	//Error stream
@@ -63,7 +138,20 @@ static void shell_handle_input()
 	//Executable name
 	char* executable_name = NULL;
 
-	if(input_parser(buffer, buffer_index, &executable_name, &argc, &args, &in_stream, &del_in_stream, &out_stream, &del_out_stream, &err_stream, &del_err_stream) == 0)
+	//A command is required on both sides of a pipe
+	size_t start = 0;
+	while(start < size && input[start] == ' ')
+		start++;
+	if(start == size)
+	{
+		FILE* err_stream = shell_out_stream_get();
+		vfsWrite(err_stream, "Missing command", 15);
+		vfsFlush(err_stream);
+		returnCode = -1;
+		return;
+	}
+
+	if(input_parser(&input[start], size - start, &executable_name, &argc, &args, &in_stream, &del_in_stream, &out_stream, &del_out_stream, &err_stream, &del_err_stream) == 0)
 	{
 		if(shell_check_intern_program(args[0]))
 		{
@@ -92,11 +180,12 @@ static void shell_handle_input()
 		}
 	}
 
+	//The pipe ends are closed by the caller
 	if(del_in_stream)
 		vfsClose(in_stream);
-	else
+	else if(in_stream == shell_in_stream_get())
 		//If the in stream was used empty it
-		shell_in_empty_buffer();	
+		shell_in_empty_buffer();
 	if(del_out_stream)
 		vfsClose(out_stream);
 	if(del_err_stream)
@@ -216,7 +305,10 @@ static bool shell_check_intern_program(const char* exe)
 	return
 		memcmp(exe, "cd", 2) == 0
 		|| memcmp(exe, "pwd", 3) == 0
-		|| memcmp(exe, "shutdown", 8) == 0;
+		|| memcmp(exe, "shutdown", 8) == 0
+		|| memcmp(exe, "heapstat", 8) == 0
+		|| memcmp(exe, "heaptrace", 9) == 0
+		|| memcmp(exe, "bindnow", 7) == 0;
 }
 static int shell_handle_intern_program(FILE* in_stream, FILE* out_stream, FILE* err_stream, const char* exe, int argc, char *argv[])
 {
@@ -250,6 +342,31 @@ static int shell_handle_intern_program(FILE* in_stream, FILE* out_stream, FILE*
 
 		return 0;
 	}
+	if(memcmp(exe, "heapstat", 8) == 0)
+	{
+		return shell_print_heap_stats(out_stream);
+	}
+	if(memcmp(exe, "heaptrace", 9) == 0)
+	{
+		//Toggle writing every heap operation to the debug output
+		heap_tracing = !heap_tracing;
+		heapSetTraceHook(heap_tracing ? &shell_heap_trace : NULL);
+
+		shell_printf(out_stream, "Heap tracing %s\n", heap_tracing ? "on" : "off");
+		vfsFlush(out_stream);
+
+		return 0;
+	}
+	if(memcmp(exe, "bindnow", 7) == 0)
+	{
+		//Toggle resolving every PLT slot before a program starts
+		linker_eager_binding = !linker_eager_binding;
+
+		shell_printf(out_stream, "Eager binding %s\n", linker_eager_binding ? "on" : "off");
+		vfsFlush(out_stream);
+
+		return 0;
+	}
 	if(memcmp(exe, "shutdown", 8) == 0)
 	{
 		//QEMU Shutdown
@@ -262,6 +379,84 @@ static int shell_handle_intern_program(FILE* in_stream, FILE* out_stream, FILE*
 	return -100;
 }
 
+//Lines are kept to the width of the screen, longer ones get cut
+static void shell_printf(FILE* stream, const char* format, ...)
+{
+	char line[81];
+
+	va_list ap;
+	va_start(ap, format);
+	int written = vsnprintf(line, sizeof(line), format, ap);
+	va_end(ap);
+
+	//Keep the line break of a cut line
+	size_t length = strlen(format);
+	if(written >= (int)sizeof(line) - 1 && length > 0 && format[length - 1] == '\n')
+		line[sizeof(line) - 2] = '\n';
+
+	vfsPuts(line, stream);
+}
+//Writes a heap operation to the debug output
+//The lines can be replayed by the heapbench host tool
+static void shell_heap_trace(char op, uintptr_t ptr, size_t size, uintptr_t old)
+{
+	debug_printf("[HEAPTRACE] %c %x %u %x", op, ptr, size, old);
+}
+//Prints the heap and PMM statistics
+static int shell_print_heap_stats(FILE* out_stream)
+{
+	heap_stats_t heap;
+	pmm_stats_t pmm;
+	pagecache_stats_t cache;
+	arena_stats_t arenas;
+	heap_chunk_info_t chunks[SHELL_HEAPSTAT_ROWS];
+	heap_caller_t callers[SHELL_HEAPSTAT_ROWS];
+
+	//Collect everything first so the output doesn't influence the numbers
+	heapGetStats(&heap);
+	pmmGetStats(&pmm);
+	pagecacheGetStats(&cache);
+	arenaGetStats(&arenas);
+	size_t chunk_count = heapGetChunks(chunks, SHELL_HEAPSTAT_ROWS);
+	size_t caller_count = heapGetCallers(callers, SHELL_HEAPSTAT_ROWS);
+
+	shell_printf(out_stream, "Heap: %u bytes in %u objects, peak %u bytes\n", heap.liveBytes, heap.liveObjects, heap.peakBytes);
+	shell_printf(out_stream, "      %u allocs, %u frees, %u failed\n", heap.allocations, heap.frees, heap.failed);
+	shell_printf(out_stream, "      %u chunks, %u bytes, %u free\n", heap.chunks, heap.chunkBytes, heap.freeBytes);
+	shell_printf(out_stream, "      largest gap %u, fragmentation %u%%\n", heap.largestFree, heap.fragmentation);
+	shell_printf(out_stream, "      krealloc copied %u bytes, saved %u bytes\n", heap.reallocCopied, heap.reallocSaved);
+	shell_printf(out_stream, "PMM:  %u/%u blocks used, peak %u\n", pmm.usedBlocks, pmm.totalBlocks, pmm.peakUsedBlocks);
+	shell_printf(out_stream, "      largest free run %u, %u zeroed\n", pmm.largestFreeRun, pmm.zeroedBlocks);
+	shell_printf(out_stream, "Arenas: %u destroyed, %u blocks released\n", arenas.destroyed, arenas.releasedBlocks);
+	shell_printf(out_stream, "      realloc copied %u bytes, saved %u bytes\n", arenas.reallocCopied, arenas.reallocSaved);
+	shell_printf(out_stream, "Page cache: %u pages, %u dirty\n", cache.pages, cache.dirtyPages);
+	shell_printf(out_stream, "      %u hits, %u misses in %u reads\n", cache.hits, cache.misses, cache.reads);
+	shell_printf(out_stream, "      %u evicted, %u written back\n", cache.evictions, cache.writebacks);
+
+	shell_printf(out_stream, "Sizes:");
+	for(size_t i = 0, limit = 16; i < HEAP_HISTOGRAM_SIZE; i++, limit <<= 1)
+		shell_printf(out_stream, i == HEAP_HISTOGRAM_SIZE - 1 ? " >%u:%u" : " %u:%u", i == HEAP_HISTOGRAM_SIZE - 1 ? limit / 2 : limit, heap.histogram[i]);
+	shell_printf(out_stream, "\n");
+
+	shell_printf(out_stream, "Chunks (%u):\n", chunk_count);
+	for(size_t i = 0; i < chunk_count && i < SHELL_HEAPSTAT_ROWS; i++)
+	{
+		size_t bytes = chunks[i].blocks * PMM_BLOCK_SIZE;
+		shell_printf(out_stream, "  0x%.8x %u blocks %u allocs %u%% used, largest gap %u\n",
+			chunks[i].address, chunks[i].blocks, chunks[i].allocations, chunks[i].usedBytes * 100 / bytes, chunks[i].largestFree);
+	}
+
+	shell_printf(out_stream, "Callers by live bytes:\n");
+	for(size_t i = 0; i < caller_count; i++)
+	{
+		shell_printf(out_stream, "  0x%.8x %u bytes in %u objects, %u allocs\n",
+			callers[i].caller, callers[i].liveBytes, callers[i].liveObjects, callers[i].allocations);
+	}
+
+	vfsFlush(out_stream);
+	return 0;
+}
+
 //------------------------------------------------------------------------------------------
 //				Public Function
 //------------------------------------------------------------------------------------------
@@ -59,31 +59,23 @@ static void writeBufferedStream(characterStream_t* stream, char character)
 	}
 	else
 	{
-		//Get new buffer with more size
-		char* newBuffer = (char*)kmalloc(s->bufferSize * 2);
+		//Grow the buffer. The heap extends it in place if possible
+		char* newBuffer = (char*)krealloc(s->buffer, s->bufferSize * 2);
 
-		//Copy data
+		//Move the wrapped around part behind the old end
 		if(s->bufferBase != 0)
 		{
 			size_t toEnd = s->bufferSize - s->bufferBase;
 			size_t fromStart = s->count - toEnd;
-			memcpy(newBuffer, (s->buffer + s->bufferBase), toEnd);
-			memcpy(newBuffer + toEnd, s->buffer, fromStart);
-		}
-		else
-		{
-			memcpy(newBuffer, s->buffer + s->bufferBase, s->count);
+			memcpy(newBuffer + s->bufferSize, newBuffer, fromStart);
 		}
 
-		//Free old buffer
-		kfree(s->buffer);
 		//Set vars to new buffer
 		s->buffer = newBuffer;
 		s->bufferSize *= 2;
-		s->bufferBase = 0;
 
 		//Add character
-		s->buffer[s->count] = character;
+		s->buffer[getNextIndex(s)] = character;
 		s->count++;
 	}
 }
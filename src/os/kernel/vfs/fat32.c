@@ -184,6 +184,14 @@ typedef struct dir_chain_t
 	struct dir_chain_t *next;
 } dir_chain_t;
 
+// Position inside the segments of a vectored operation
+typedef struct iov_cursor_t
+{
+	const struct iovec *iov; // Current segment
+	int iovcnt;              // Segments left (including the current one)
+	size_t offset;           // Offset inside the current segment
+} iov_cursor_t;
+
 //------------------------------------------------------------------------------------------
 //				Variables
 //------------------------------------------------------------------------------------------
@@ -205,10 +213,11 @@ static size_t getClusterCount(cluster_chain_t *chain);
 static int doClusterOperation(void* buf, mountpoint_t *metadata, cluster_chain_t *chain, uint32_t offset, bool write);
 static int removeCluster(cluster_chain_t *chain, mountpoint_t *metadata);
 static cluster_chain_t *addCluster(cluster_chain_t *chain, mountpoint_t *metadata);
+static int reserveClusters(cluster_chain_t *chain, mountpoint_t *metadata, size_t count);
 static cluster_chain_t *createChain(mountpoint_t *metadata, size_t size);
 static int shrinkChain(mountpoint_t *metadata, cluster_chain_t *chain, size_t newSize);
 
-static dir_chain_t *parseDirectory(file_desc_t *file);
+static dir_chain_t *parseDirectory(file_desc_t *file, bool *complete);
 static char *getFullName(dir_entry_t *entry, lfn_chain_t *lfn);
 static void addLFNEntry(lfn_chain_t **chain, lfn_entry_t *entry);
 static char *parseShortName(dir_entry_t *entry);
@@ -223,7 +232,8 @@ static int initDirectory(file_desc_t *dir);
 
 static file_desc_t *createFile(file_desc_t *root, dir_chain_t *direntry);
 
-static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, char *buf, bool write);
+static void copyVector(iov_cursor_t *cursor, char *buf, size_t amount, bool toVector);
+static size_t doFileOperation(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt, bool write);
 
 //------------------------------------------------------------------------------------------
 //				Private function implementations
@@ -518,6 +528,111 @@ static cluster_chain_t *addCluster(cluster_chain_t *chain, mountpoint_t *metadat
 	return chain;
 }
 
+// Appends count clusters to the chain, preferably as one contiguous run directly behind its last cluster.
+// The clusters aren't cleared as they only hold file data that is about to be written.
+// Falls back to addCluster if there is no free run long enough
+static int reserveClusters(cluster_chain_t *chain, mountpoint_t *metadata, size_t count)
+{
+	fat32_metadata_t *data = ((fat32_metadata_t*)metadata->metadata);
+	uint32_t bps = data->bpb->bytesPerSector;
+	uint32_t sectors = data->bpb->sectorCount == 0 ? data->bpb->largeSectorCount : data->bpb->sectorCount;
+	uint32_t total = sectors / data->bpb->sectorsPerCluster; // Same bound as addCluster
+
+	// Find last cluster in the chain
+	cluster_chain_t *last = chain;
+	for (; last->next; last = last->next);
+
+	uint8_t table[bps];
+	uint32_t sector = 0, runStart = 0, runLength = 0;
+
+	// Search the FAT for a run of free clusters, starting behind the chain
+	uint32_t cluster = last->index + 1;
+	for (uint32_t i = 2; i < total && runLength < count; i++, cluster++)
+	{
+		// Wrap around to the first cluster, a run can't span the end
+		if (cluster >= total)
+		{
+			cluster = 2;
+			runLength = 0;
+		}
+
+		uint32_t newSector = data->firstFATSector + (cluster * 4 / bps);
+
+		// Check if we crossed a sector boundary
+		if (newSector != sector)
+		{
+			sector = newSector;
+
+			if (ataRead((void*)table, sector, 1, metadata->partition->device))
+				return EOF;
+		}
+
+		if ((*(uint32_t*)&table[(cluster * 4) % bps] & FAT_MASK) != 0)
+			runLength = 0;
+		else if (runLength++ == 0)
+			runStart = cluster;
+	}
+
+	// Fragmented partition, take the clusters one by one
+	if (runLength < count)
+	{
+		for (; count > 0; count--)
+			if (!addCluster(chain, metadata))
+				return EOF;
+
+		return 0;
+	}
+
+	// Link the clusters of the run, every FAT sector is written once
+	sector = 0;
+	for (cluster = runStart; cluster < runStart + count; cluster++)
+	{
+		uint32_t newSector = data->firstFATSector + (cluster * 4 / bps);
+
+		if (newSector != sector)
+		{
+			if (sector && ataWrite((void*)table, sector, 1, metadata->partition->device))
+				return EOF;
+
+			sector = newSector;
+
+			if (ataRead((void*)table, sector, 1, metadata->partition->device))
+				return EOF;
+		}
+
+		*(uint32_t*)&table[(cluster * 4) % bps] = cluster == runStart + count - 1 ? 0x0FFFFFFF : cluster + 1;
+	}
+
+	if (ataWrite((void*)table, sector, 1, metadata->partition->device))
+		return EOF;
+
+	// Let the previous last cluster point to the run
+	sector = data->firstFATSector + (last->index * 4 / bps);
+
+	if (ataRead((void*)table, sector, 1, metadata->partition->device))
+		return EOF;
+
+	*(uint32_t*)&table[(last->index * 4) % bps] = runStart;
+
+	if (ataWrite((void*)table, sector, 1, metadata->partition->device))
+		return EOF;
+
+	// Update the chain in memory
+	last->value = runStart;
+
+	for (cluster = runStart; cluster < runStart + count; cluster++)
+	{
+		cluster_chain_t *new = kzalloc(sizeof(cluster_chain_t));
+		new->index = cluster;
+		new->value = cluster == runStart + count - 1 ? 0x0FFFFFFF : cluster + 1;
+
+		last->next = new;
+		last = new;
+	}
+
+	return 0;
+}
+
 // Create a cluster chain able to hold a file of the specified size
 static cluster_chain_t *createChain(mountpoint_t *metadata, size_t size)
 {
@@ -612,13 +727,24 @@ static int doClusterOperation(void* buf, mountpoint_t *metadata, cluster_chain_t
 }
 
 // Reads the complete directory into a traversable chain
-static dir_chain_t *parseDirectory(file_desc_t *file)
+// Complete (optional) is only set if no entry got lost to a read or allocation error
+static dir_chain_t *parseDirectory(file_desc_t *file, bool *complete)
 {
 	cluster_chain_t *chain = getChain(file->mount, file->inode);
 
 	fat32_metadata_t *metadata = (fat32_metadata_t*)file->mount->metadata;
 
+	if (complete)
+		*complete = false;
+
 	uint8_t* buf = kmalloc(metadata->bytesPerCluster);
+	if (!chain || !buf)
+	{
+		deleteClusterChain(chain);
+		kfree(buf);
+		return NULL;
+	}
+
 	uint32_t offset = metadata->bytesPerCluster;
 	int cluster = -1;
 	
@@ -679,6 +805,16 @@ static dir_chain_t *parseDirectory(file_desc_t *file)
 
 			// Create new chain entry
 			dir_chain_t *next = kzalloc(sizeof(dir_chain_t));
+			if (!next || !fullname)
+			{
+				kfree(next);
+				kfree(fullname);
+				deleteClusterChain(chain);
+				kfree(buf);
+
+				return dir;
+			}
+
 			next->entry = *entry;
 			next->fullname = fullname;
 
@@ -700,6 +836,9 @@ static dir_chain_t *parseDirectory(file_desc_t *file)
 	deleteClusterChain(chain);
 	kfree(buf);
 
+	if (complete)
+		*complete = true;
+
 	return dir;
 }
 
@@ -1317,6 +1456,9 @@ static file_desc_t *createFile(file_desc_t *root, dir_chain_t *direntry)
 		file->flags = FS_FILE;
 		file->read = (read_callback)readFAT32;
 		file->write = (write_callback)writeFAT32;
+		file->readv = (readv_callback)readvFAT32;
+		file->writev = (writev_callback)writevFAT32;
+		file->reserve = (reserve_callback)reserveFAT32;
 		file->length = direntry->entry.size;
 	}
 
@@ -1331,12 +1473,49 @@ static file_desc_t *createFile(file_desc_t *root, dir_chain_t *direntry)
 	return file;
 }
 
-// Writes/reads a specific part from/into the buffer into/from the file
-static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, char *buf, bool write)
+// Copies between the segments at the cursor and the buffer and advances the cursor
+static void copyVector(iov_cursor_t *cursor, char *buf, size_t amount, bool toVector)
 {
+	while (amount > 0 && cursor->iovcnt > 0)
+	{
+		size_t length = cursor->iov->iov_len - cursor->offset;
+		if (length > amount)
+			length = amount;
+
+		char *segment = (char*)cursor->iov->iov_base + cursor->offset;
+
+		if (toVector)
+			memcpy(segment, buf, length);
+		else
+			memcpy(buf, segment, length);
+
+		buf += length;
+		amount -= length;
+		cursor->offset += length;
+
+		// Go to the next segment
+		if (cursor->offset == cursor->iov->iov_len)
+		{
+			cursor->iov++;
+			cursor->iovcnt--;
+			cursor->offset = 0;
+		}
+	}
+}
+
+// Writes/reads a specific part from/into the segments into/from the file
+// The segments are gathered/scattered cluster by cluster, so every cluster is only accessed once
+static size_t doFileOperation(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt, bool write)
+{
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
 	if (size == 0 || offset > file->length)
 		return 0;
 
+	iov_cursor_t cursor = { iov, iovcnt, 0 };
+
 	cluster_chain_t *chain = getChain(file->mount, file->inode);
 	fat32_metadata_t *metadata = (fat32_metadata_t*)file->mount->metadata;
 	uint32_t bpc = metadata->bytesPerCluster; // Abbreviation as the value gets used often
@@ -1348,20 +1527,20 @@ static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, cha
 		if (write)
 		{
 			// Round up new size to full clusters
-			int toAllocate = (((offset + size) + bpc - 1) / bpc) - getClusterCount(chain);
+			size_t clusters = getClusterCount(chain);
+			int toAllocate = (((offset + size) + bpc - 1) / bpc) - clusters;
 
-			// Allocated necessary clusters
-			for (; toAllocate > 0; toAllocate--)
+			// Allocated necessary clusters (in one piece if possible)
+			if (toAllocate > 0 && reserveClusters(chain, file->mount, toAllocate))
 			{
-				if (!addCluster(chain, file->mount))
-				{
-					debug_set_color(0x0C, 0x00);
-					debug_print("The partition is full! Could'nt allocate a new cluster!");
-					debug_set_color(0x0F, 0x00);
+				debug_set_color(0x0C, 0x00);
+				debug_print("The partition is full! Could'nt allocate a new cluster!");
+				debug_set_color(0x0F, 0x00);
 
-					kfree(chain);
-					return 0;
-				}
+				// Release the clusters that could be added
+				shrinkChain(file->mount, chain, clusters * bpc);
+				deleteClusterChain(chain);
+				return 0;
 			}
 
 			// Update file length and directory entry
@@ -1416,7 +1595,7 @@ static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, cha
 					return index;
 				}
 			}
-			memcpy(tmpBuf + start, buf + index, amount);
+			copyVector(&cursor, tmpBuf + start, amount, false);
 		}
 		
 		if (doClusterOperation(tmpBuf, file->mount, chain, i, write))
@@ -1431,7 +1610,7 @@ static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, cha
 		}
 		
 		if (!write)
-			memcpy(buf + index, tmpBuf + start, amount);
+			copyVector(&cursor, tmpBuf + start, amount, true);
 
 		index += amount;
 	}
@@ -1452,17 +1631,63 @@ static size_t doFileOperation(file_desc_t *file, size_t offset, size_t size, cha
 
 size_t readFAT32(file_desc_t *node, size_t offset, size_t size, char *buf)
 {
-	return doFileOperation(node, offset, size, buf, READ);
+	struct iovec iov = { buf, size };
+	return doFileOperation(node, offset, &iov, 1, READ);
 }
 
 size_t writeFAT32(file_desc_t *node, size_t offset, size_t size, char *buf)
 {
-	return doFileOperation(node, offset, size, buf, WRITE);
+	struct iovec iov = { buf, size };
+	return doFileOperation(node, offset, &iov, 1, WRITE);
+}
+
+// Makes room for a file of the specified size without changing its length,
+// so later writes don't have to allocate clusters one by one.
+// Clusters past the length and the specified size are released again
+int reserveFAT32(file_desc_t *node, size_t size)
+{
+	fat32_metadata_t *metadata = (fat32_metadata_t*)node->mount->metadata;
+	cluster_chain_t *chain = getChain(node->mount, node->inode);
+
+	if (!chain)
+		return EOF;
+
+	// The data of the file stays, and every file keeps its first cluster
+	size_t length = node->length ? node->length : 1;
+	if (size < length)
+		size = length;
+
+	size_t needed = (size + metadata->bytesPerCluster - 1) / metadata->bytesPerCluster;
+	size_t count = getClusterCount(chain);
+
+	int ret = 0;
+	if (needed < count)
+		ret = shrinkChain(node->mount, chain, size);
+	else if (needed > count && reserveClusters(chain, node->mount, needed - count))
+	{
+		// Don't keep the part of the clusters that could be added
+		shrinkChain(node->mount, chain, length);
+		ret = EOF;
+	}
+
+	deleteClusterChain(chain);
+
+	return ret;
+}
+
+size_t readvFAT32(file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	return doFileOperation(node, offset, iov, iovcnt, READ);
+}
+
+size_t writevFAT32(file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	return doFileOperation(node, offset, iov, iovcnt, WRITE);
 }
 
 int readdirFAT32(DIR *dirstream)
 {
-	dir_chain_t *directory = parseDirectory(dirstream->dirfile);
+	dir_chain_t *directory = parseDirectory(dirstream->dirfile, NULL);
 
 	// Get correct directory entry
 	dir_chain_t *current = directory;
@@ -1497,11 +1722,12 @@ int readdirFAT32(DIR *dirstream)
 	return ret;
 }
 
-file_desc_t *findfileFAT32(file_desc_t *node, char *name)
+file_desc_t *findfileFAT32(file_desc_t *node, char *name, bool *missing)
 {
 	debug_printf("findfileFAT32: %s", name);
 
-	dir_chain_t *directory = parseDirectory(node);
+	bool complete;
+	dir_chain_t *directory = parseDirectory(node, &complete);
 
 	for (dir_chain_t *current = directory; current; current = current->next)
 	{
@@ -1515,6 +1741,9 @@ file_desc_t *findfileFAT32(file_desc_t *node, char *name)
 
 	deleteDirectoryChain(directory);
 
+	// The name is only missing if the whole directory could be read
+	*missing = complete;
+
 	return 0;
 }
 
@@ -1542,6 +1771,9 @@ int mkfileFAT32(file_desc_t *file)
 	{
 		file->read = (read_callback)readFAT32;
 		file->write = (write_callback)writeFAT32;
+		file->readv = (readv_callback)readvFAT32;
+		file->writev = (writev_callback)writevFAT32;
+		file->reserve = (reserve_callback)reserveFAT32;
 	}
 	else
 	{
@@ -1649,6 +1881,8 @@ mountpoint_t *mountFAT32(partition_t *partition)
 	mount->partition = partition;
 	mount->root = rootdir;
 	mount->metadata = (uintptr_t)metadata;
+	mount->blockSize = metadata->bytesPerCluster;
+	mount->flags = 0;
 	mount->unmount = (unmount_callback)unmountFAT32;
 
 	return mount;
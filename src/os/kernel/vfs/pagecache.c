@@ -0,0 +1,634 @@
+#include <vfs/pagecache.h>
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <memory/heap.h>
+#include <memory/pmm.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define PAGE_SIZE PMM_BLOCK_SIZE // Every page is backed by one PMM block
+#define PAGECACHE_BUCKETS 128    // Buckets of the page lookup table
+#define PAGECACHE_READ_RUN 32    // Missing pages read with one filesystem call
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// One cached page of file data
+typedef struct cache_page_t
+{
+	// Key: The file and the page index inside it
+	mountpoint_t *mount;
+	uint32_t inode;
+	size_t index;
+
+	char *data;   // PMM block holding the file data
+	size_t valid; // Bytes of file data inside the page (less at the end of the file)
+
+	// Range modified since the page was last written back
+	// (the file is only set while the page is dirty)
+	file_desc_t *dirtyFile;
+	size_t dirtyStart;
+	size_t dirtyEnd;
+
+	struct cache_page_t *hashNext; // Next page in the same bucket
+
+	// Position in the list of all pages sorted by their last use
+	struct cache_page_t *lruPrev;
+	struct cache_page_t *lruNext;
+} cache_page_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+static cache_page_t *buckets[PAGECACHE_BUCKETS];
+
+static cache_page_t *lruHead; // Most recently used
+static cache_page_t *lruTail; // Least recently used
+
+static pagecache_stats_t stats;
+
+//------------------------------------------------------------------------------------------
+//				Private function declarations
+//------------------------------------------------------------------------------------------
+
+static inline size_t bucketIndex(mountpoint_t *mount, uint32_t inode, size_t index);
+static inline bool isPageOf(cache_page_t *page, file_desc_t *file);
+
+static cache_page_t *findPage(file_desc_t *file, size_t index);
+static void touchPage(cache_page_t *page);
+static void freePage(cache_page_t *page);
+
+static int writebackPage(cache_page_t *page);
+static bool evictPage();
+
+static cache_page_t *allocPage(file_desc_t *file, size_t index, size_t pending);
+static void linkPage(cache_page_t *page);
+static cache_page_t *readRun(file_desc_t *file, size_t index, size_t count);
+static cache_page_t *loadPage(file_desc_t *file, size_t index, size_t count, bool overwrite);
+static void updatePages(file_desc_t *file, size_t offset, size_t size, const char *buf);
+static size_t uncachedRange(file_desc_t *file, size_t offset, size_t size);
+static size_t readPages(file_desc_t *file, size_t offset, size_t size, char *buf, size_t end);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+static inline size_t bucketIndex(mountpoint_t *mount, uint32_t inode, size_t index)
+{
+	return ((uintptr_t)mount ^ (inode * 2654435761u) ^ (index * 40503u)) % PAGECACHE_BUCKETS;
+}
+
+static inline bool isPageOf(cache_page_t *page, file_desc_t *file)
+{
+	return page->mount == file->mount && page->inode == file->inode;
+}
+
+// Finds a cached page of the file
+static cache_page_t *findPage(file_desc_t *file, size_t index)
+{
+	cache_page_t *page = buckets[bucketIndex(file->mount, file->inode, index)];
+
+	for (; page; page = page->hashNext)
+	{
+		if (isPageOf(page, file) && page->index == index)
+			return page;
+	}
+
+	return NULL;
+}
+
+// Marks the page as the most recently used one
+static void touchPage(cache_page_t *page)
+{
+	if (page == lruHead)
+		return;
+
+	// Unlink from the current position
+	page->lruPrev->lruNext = page->lruNext;
+
+	if (page->lruNext)
+		page->lruNext->lruPrev = page->lruPrev;
+	else
+		lruTail = page->lruPrev;
+
+	// Link at the head
+	page->lruPrev = NULL;
+	page->lruNext = lruHead;
+	lruHead->lruPrev = page;
+	lruHead = page;
+}
+
+// Unlinks the page and frees its memory without writing it back
+static void freePage(cache_page_t *page)
+{
+	// Unlink from the bucket
+	cache_page_t **link = &buckets[bucketIndex(page->mount, page->inode, page->index)];
+	while (*link != page)
+		link = &(*link)->hashNext;
+
+	*link = page->hashNext;
+
+	// Unlink from the LRU list
+	if (page->lruPrev) page->lruPrev->lruNext = page->lruNext;
+	else lruHead = page->lruNext;
+
+	if (page->lruNext) page->lruNext->lruPrev = page->lruPrev;
+	else lruTail = page->lruPrev;
+
+	if (page->dirtyFile)
+		stats.dirtyPages--;
+
+	stats.pages--;
+
+	pmmFree(page->data);
+	kfree(page);
+}
+
+// Writes the modified range of a dirty page to the filesystem
+static int writebackPage(cache_page_t *page)
+{
+	file_desc_t *file = page->dirtyFile;
+	size_t size = page->dirtyEnd - page->dirtyStart;
+
+	size_t amount = file->write(file, page->index * PAGE_SIZE + page->dirtyStart, size, page->data + page->dirtyStart);
+
+	if (amount < size)
+	{
+		debug_set_color(0x0C, 0x00);
+		debug_printf("[PAGECACHE] Couldn't write back page %u of %s", page->index, file->name);
+		debug_set_color(0x0F, 0x00);
+		return EOF;
+	}
+
+	page->dirtyFile = NULL;
+	stats.dirtyPages--;
+	stats.writebacks++;
+
+	return 0;
+}
+
+// Drops the least recently used page. Dirty pages get written back first
+// Returns false if no page could be evicted
+static bool evictPage()
+{
+	for (cache_page_t *page = lruTail; page; page = page->lruPrev)
+	{
+		if (page->dirtyFile && writebackPage(page))
+			continue;
+
+		freePage(page);
+		stats.evictions++;
+
+		return true;
+	}
+
+	return false;
+}
+
+// Allocates a page of the file which isn't linked into the cache yet.
+// Pending pages are allocated but not linked yet, they count against the limit too
+static cache_page_t *allocPage(file_desc_t *file, size_t index, size_t pending)
+{
+	// Make room for the new page
+	if (stats.pages + pending >= PAGECACHE_MAX_PAGES)
+		evictPage();
+
+	// Give up cached pages if physical memory runs out
+	char *data = pmmAlloc();
+	while (!data && evictPage())
+		data = pmmAlloc();
+
+	if (!data)
+		return NULL;
+
+	cache_page_t *page = kzalloc(sizeof(cache_page_t));
+
+	if (!page)
+	{
+		pmmFree(data);
+		return NULL;
+	}
+
+	page->mount = file->mount;
+	page->inode = file->inode;
+	page->index = index;
+	page->data = data;
+
+	return page;
+}
+
+// Links the page into its bucket and at the head of the LRU list
+static void linkPage(cache_page_t *page)
+{
+	size_t bucket = bucketIndex(page->mount, page->inode, page->index);
+	page->hashNext = buckets[bucket];
+	buckets[bucket] = page;
+
+	page->lruNext = lruHead;
+	if (lruHead)
+		lruHead->lruPrev = page;
+	else
+		lruTail = page;
+
+	lruHead = page;
+	stats.pages++;
+}
+
+// Reads a run of missing pages with one vectored filesystem call.
+// The run ends at the end of the file or at the next page which is cached already
+// Returns the first page or NULL if it couldn't be read
+static cache_page_t *readRun(file_desc_t *file, size_t index, size_t count)
+{
+	cache_page_t *run[PAGECACHE_READ_RUN];
+	struct iovec iov[PAGECACHE_READ_RUN];
+	size_t pageCount = 0;
+
+	if (count > PAGECACHE_READ_RUN)
+		count = PAGECACHE_READ_RUN;
+
+	for (; pageCount < count && (index + pageCount) * PAGE_SIZE < file->length; pageCount++)
+	{
+		if (pageCount > 0 && findPage(file, index + pageCount))
+			break;
+
+		cache_page_t *page = allocPage(file, index + pageCount, pageCount);
+		if (!page)
+			break;
+
+		run[pageCount] = page;
+		iov[pageCount].iov_base = page->data;
+		iov[pageCount].iov_len = PAGE_SIZE;
+	}
+
+	if (pageCount == 0)
+		return NULL;
+
+	// The last page only gets the data up to the end of the file
+	size_t end = (index + pageCount) * PAGE_SIZE;
+	if (end > file->length)
+		iov[pageCount - 1].iov_len -= end - file->length;
+
+	stats.misses += pageCount;
+	stats.reads++;
+
+	size_t amount = file->readv(file, index * PAGE_SIZE, iov, pageCount);
+
+	// Keep the pages the read reached
+	for (size_t i = 0; i < pageCount; i++)
+	{
+		cache_page_t *page = run[i];
+		size_t start = i * PAGE_SIZE;
+
+		if (amount <= start)
+		{
+			pmmFree(page->data);
+			kfree(page);
+			run[i] = NULL;
+			continue;
+		}
+
+		page->valid = amount - start < iov[i].iov_len ? amount - start : iov[i].iov_len;
+		linkPage(page);
+	}
+
+	return run[0];
+}
+
+// Gets a page of the file, reading it from the filesystem if it isn't cached.
+// Count is the number of pages the caller is about to read, missing ones are read together.
+// Pages that are about to be overwritten completely don't get read
+static cache_page_t *loadPage(file_desc_t *file, size_t index, size_t count, bool overwrite)
+{
+	cache_page_t *page = findPage(file, index);
+
+	if (page)
+	{
+		stats.hits++;
+		touchPage(page);
+		return page;
+	}
+
+	if (!overwrite && count > 1 && file->readv)
+		return readRun(file, index, count);
+
+	stats.misses++;
+
+	page = allocPage(file, index, 0);
+
+	if (!page)
+		return NULL;
+
+	if (!overwrite && index * PAGE_SIZE < file->length)
+	{
+		stats.reads++;
+		page->valid = file->read(file, index * PAGE_SIZE, PAGE_SIZE, page->data);
+
+		// Read error
+		if (page->valid == 0)
+		{
+			pmmFree(page->data);
+			kfree(page);
+			return NULL;
+		}
+	}
+
+	linkPage(page);
+
+	return page;
+}
+
+// Copies data written past the cache into the cached pages it overlaps
+static void updatePages(file_desc_t *file, size_t offset, size_t size, const char *buf)
+{
+	for (size_t done = 0; done < size;)
+	{
+		size_t pos = offset + done;
+		size_t start = pos % PAGE_SIZE;
+		size_t amount = PAGE_SIZE - start;
+		if (amount > size - done)
+			amount = size - done;
+
+		cache_page_t *page = findPage(file, pos / PAGE_SIZE);
+
+		if (page)
+		{
+			if (start > page->valid) // Would leave a hole inside the page
+				freePage(page);
+			else
+			{
+				memcpy(page->data + start, buf + done, amount);
+
+				if (start + amount > page->valid)
+					page->valid = start + amount;
+			}
+		}
+
+		done += amount;
+	}
+}
+
+// Returns how much of the range lies before the next cached page.
+// Only that part may bypass the cache, later pages can hold newer data than the disk
+static size_t uncachedRange(file_desc_t *file, size_t offset, size_t size)
+{
+	size_t amount = PAGE_SIZE - offset % PAGE_SIZE;
+
+	for (size_t index = offset / PAGE_SIZE + 1; amount < size && !findPage(file, index); index++)
+		amount += PAGE_SIZE;
+
+	return amount < size ? amount : size;
+}
+
+// Reads file data through the page cache.
+// End is where the whole request of the caller ends, missing pages up to it are read together
+static size_t readPages(file_desc_t *file, size_t offset, size_t size, char *buf, size_t end)
+{
+	if (offset >= file->length)
+		return 0;
+
+	if (size > file->length - offset)
+		size = file->length - offset;
+
+	if (end > file->length)
+		end = file->length;
+
+	size_t done = 0;
+
+	while (done < size)
+	{
+		size_t pos = offset + done;
+		size_t start = pos % PAGE_SIZE;
+
+		size_t index = pos / PAGE_SIZE;
+		cache_page_t *page = loadPage(file, index, (end - 1) / PAGE_SIZE - index + 1, false);
+
+		// Out of memory, read directly up to the next cached page
+		if (!page)
+		{
+			size_t amount = uncachedRange(file, pos, size - done);
+			size_t read = file->read(file, pos, amount, buf + done);
+			done += read;
+
+			if (read < amount)
+				break;
+
+			continue;
+		}
+
+		if (start >= page->valid)
+			break;
+
+		size_t amount = page->valid - start;
+		if (amount > size - done)
+			amount = size - done;
+
+		memcpy(buf + done, page->data + start, amount);
+		done += amount;
+	}
+
+	return done;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Reads file data through the page cache
+size_t pagecacheRead(file_desc_t *file, size_t offset, size_t size, char *buf)
+{
+	return readPages(file, offset, size, buf, offset + size);
+}
+
+// Writes file data into the page cache.
+// Writes extending the file go straight to the filesystem, as the driver has to
+// allocate the space and update the file length. Everything else gets written back later
+size_t pagecacheWrite(file_desc_t *file, size_t offset, size_t size, char *buf)
+{
+	if (size == 0)
+		return 0;
+
+	if (offset + size > file->length)
+	{
+		size_t amount = file->write(file, offset, size, buf);
+		updatePages(file, offset, amount, buf);
+		return amount;
+	}
+
+	size_t done = 0;
+
+	while (done < size)
+	{
+		size_t pos = offset + done;
+		size_t start = pos % PAGE_SIZE;
+		size_t amount = PAGE_SIZE - start;
+		if (amount > size - done)
+			amount = size - done;
+
+		cache_page_t *page = loadPage(file, pos / PAGE_SIZE, 1, start == 0 && amount == PAGE_SIZE);
+
+		// Out of memory, write directly up to the next cached page
+		if (!page)
+		{
+			amount = uncachedRange(file, pos, size - done);
+			size_t written = file->write(file, pos, amount, buf + done);
+			done += written;
+
+			if (written < amount)
+				break;
+
+			continue;
+		}
+
+		memcpy(page->data + start, buf + done, amount);
+
+		if (start + amount > page->valid)
+			page->valid = start + amount;
+
+		// Extend the dirty range
+		if (!page->dirtyFile)
+		{
+			page->dirtyFile = file;
+			page->dirtyStart = start;
+			page->dirtyEnd = start + amount;
+			stats.dirtyPages++;
+		}
+		else
+		{
+			if (start < page->dirtyStart)
+				page->dirtyStart = start;
+			if (start + amount > page->dirtyEnd)
+				page->dirtyEnd = start + amount;
+		}
+
+		done += amount;
+	}
+
+	return done;
+}
+
+// Reads file data into the segments through the page cache.
+// Missing pages are read together across the segments
+size_t pagecacheReadv(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
+	size_t done = 0;
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		size_t amount = readPages(file, offset + done, iov[i].iov_len, iov[i].iov_base, offset + size);
+		done += amount;
+
+		if (amount < iov[i].iov_len)
+			break;
+	}
+
+	return done;
+}
+
+// Writes the segments into the page cache.
+// Writes extending the file are handed to the filesystem as one vectored operation
+size_t pagecacheWritev(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	size_t size = 0;
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
+	size_t done = 0;
+
+	if (offset + size > file->length && file->writev)
+	{
+		size_t amount = file->writev(file, offset, iov, iovcnt);
+
+		// Copy the written data into the cached pages it overlaps
+		for (int i = 0; i < iovcnt && done < amount; i++)
+		{
+			size_t length = iov[i].iov_len;
+			if (length > amount - done)
+				length = amount - done;
+
+			updatePages(file, offset + done, length, iov[i].iov_base);
+			done += length;
+		}
+
+		return amount;
+	}
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		size_t amount = pagecacheWrite(file, offset + done, iov[i].iov_len, iov[i].iov_base);
+		done += amount;
+
+		if (amount < iov[i].iov_len)
+			break;
+	}
+
+	return done;
+}
+
+// Writes all dirty pages of the file back to the filesystem
+int pagecacheSync(file_desc_t *file)
+{
+	int ret = 0;
+
+	for (cache_page_t *page = lruHead; page; page = page->lruNext)
+	{
+		if (page->dirtyFile && isPageOf(page, file) && writebackPage(page))
+			ret = EOF;
+	}
+
+	return ret;
+}
+
+// Drops all pages of the file without writing them back (used when it gets deleted)
+void pagecacheInvalidate(file_desc_t *file)
+{
+	for (cache_page_t *page = lruHead, *next; page; page = next)
+	{
+		next = page->lruNext;
+
+		if (isPageOf(page, file))
+			freePage(page);
+	}
+}
+
+// Drops up to count clean pages, starting with the least recently used one.
+// Set as the reclaim handler of the PMM. Dirty pages are kept, writing them back
+// would enter the filesystem which may be the one asking for memory
+// Returns the number of pages dropped
+size_t pagecacheReclaim(size_t count)
+{
+	size_t dropped = 0;
+
+	for (cache_page_t *page = lruTail, *prev; page && dropped < count; page = prev)
+	{
+		prev = page->lruPrev;
+
+		if (page->dirtyFile)
+			continue;
+
+		freePage(page);
+		stats.evictions++;
+		dropped++;
+	}
+
+	return dropped;
+}
+
+void pagecacheGetStats(pagecache_stats_t *out)
+{
+	*out = stats;
+}
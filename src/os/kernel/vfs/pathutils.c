@@ -1,124 +1,58 @@
 #include <vfs/pathutils.h>
 
-//------------------------------------------------------------------------------------------
-//				Includes
-//------------------------------------------------------------------------------------------
-
-#include <memory/heap.h>
-#include <string.h>
-
 //------------------------------------------------------------------------------------------
 //				Public function implementations
 //------------------------------------------------------------------------------------------
 
-// Get a copy from a specific part of the path
-// Use kfree to free the copy from the heap
-char *getPathSubstr(const char *path, size_t index)
+// Starts walking the first length characters of the path
+void pathIterInit(path_iter_t *iter, const char *path, size_t length)
 {
-	// Check if index is in bounds
-	size_t maxCount = getPathLength(path);
-	if (index >= maxCount)
-		return NULL;
-
-	size_t len = strlen(path);
-
-	size_t partIndex = len;
-	size_t partLen = 0;
-	size_t count = 0;
-
-	// Find area of substring
-	for (size_t i = 0; i < len; i++)
-	{
-		if (path[i] == '/')
-			count++;
-
-		if (count == index && partIndex == len && path[i] != '/')
-			partIndex = i;
-
-		if (count > index)
-		{
-			partLen = i - partIndex;
-			break;
-		}
-	}
-
-	// If there is no trailing slash the length has to be calculated
-	if (index == maxCount - 1 && partLen == 0)
-		partLen = (len + 1) - partIndex;
-
-	// Duplicate the string part
-	char *part = kstrndup(&path[partIndex], partLen);
-	return part;
+	iter->pos = path;
+	iter->end = path + length;
 }
 
-// Counts how deep the path goes
-size_t getPathLength(const char *path)
+// Gets the next component of the path as a slice of the original string
+// Returns 0 if there are no components left
+int pathIterNext(path_iter_t *iter, const char **name, size_t *length)
 {
-	if (path[0] == '\0')
+	// Skip (repeated) slashes
+	while (iter->pos < iter->end && *iter->pos == '/')
+		iter->pos++;
+
+	if (iter->pos >= iter->end || *iter->pos == '\0')
 		return 0;
 
-	size_t count = 1; // Root directory is always present
-	size_t len = strlen(path);
+	const char *start = iter->pos;
+	while (iter->pos < iter->end && *iter->pos != '/' && *iter->pos != '\0')
+		iter->pos++;
 
-	for (size_t i = 0; i < len; i++)
-	{
-		// Check for slash
-		if (path[i] == '/' && path[i + 1] != 0)
-			count++;
-	}
+	*name = start;
+	*length = (size_t)(iter->pos - start);
 
-	return count;
+	return 1;
 }
 
-// Removes the first directory entry from the path
-char *rmPathDirectory(char *path)
+// Gets the last component of the path
+// Everything before the returned pointer is the path of the directory the file lies in
+const char *getPathFile(const char *path, size_t *length)
 {
-	// Path already empty
-	if (path[0] == '\0')
-		return path;
+	const char *file = NULL;
+	*length = 0;
 
-	size_t index = 0;
-	size_t len = strlen(path);
-
-	for (size_t i = 1; i < len; i++)
+	for (const char *c = path; *c; c++)
 	{
-		if (path[i - 1] == '/')
+		if (*c == '/')
+			continue;
+
+		// Start of a new component
+		if (c == path || c[-1] == '/')
 		{
-			index = i;
-			break;
+			file = c;
+			*length = 0;
 		}
-	}
 
-	// Last iteration (only the file remains)
-	if (index == 0)
-	{
-		path[0] = '\0';
-		return path;
+		(*length)++;
 	}
 
-	// Rather use memmove as the memory regions are overlapping
-	memmove((void*)path, (void*)(path + index), len - index + 1);
-
-	return path;
-}
-
-// Gets the name of the file the path leads to
-char *getPathFile(const char *path)
-{
-	return getPathSubstr(path, getPathLength(path) - 1);
-}
-
-char *getPathDir(const char *path)
-{
-	int len = strlen(path);
-	for (; len >= 0; len--)
-		if (path[len] == '/')
-			break;
-
-	if (len < 0)
-		return NULL;
-
-	char *dir = kstrndup(path, len);
-
-	return dir;
+	return file;
 }
@@ -0,0 +1,172 @@
+#include <vfs/pipe.h>
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <limits.h>
+#include <string.h>
+
+#include <memory/heap.h>
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Ring buffer between the write end and the read end of a pipe
+// (the inode number of its file descriptor is the address of the pipe)
+typedef struct pipe_t
+{
+	char *data;
+	size_t size;  // Power of two
+	size_t head;  // Next byte to read
+	size_t count; // Buffered bytes
+} pipe_t;
+
+//------------------------------------------------------------------------------------------
+//				Private function declarations
+//------------------------------------------------------------------------------------------
+
+static inline pipe_t *pipeOf(file_desc_t *node);
+static int growPipe(pipe_t *pipe, size_t needed);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+static inline pipe_t *pipeOf(file_desc_t *node)
+{
+	return (pipe_t*)(uintptr_t)node->inode;
+}
+
+// Makes room for the needed amount of bytes.
+// Nobody reads while a stage of the shell writes, so the buffer has to hold everything
+static int growPipe(pipe_t *pipe, size_t needed)
+{
+	size_t size = pipe->size;
+	while (size < needed && size < PIPE_BUFFER_MAX)
+		size *= 2;
+
+	if (size == pipe->size)
+		return EOF;
+
+	char *data = kmalloc(size);
+	if (!data)
+		return EOF;
+
+	// Unwrap the buffered bytes to the start of the new buffer
+	size_t first = pipe->size - pipe->head;
+	if (first > pipe->count)
+		first = pipe->count;
+
+	memcpy(data, pipe->data + pipe->head, first);
+	memcpy(data + first, pipe->data, pipe->count - first);
+
+	kfree(pipe->data);
+	pipe->data = data;
+	pipe->size = size;
+	pipe->head = 0;
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Takes bytes out of the pipe, the offset is ignored.
+// An empty pipe reads as EOF, as there is no scheduler a reader could wait for
+size_t readPipe(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	(void)offset;
+	pipe_t *pipe = pipeOf(node);
+
+	if (size > pipe->count)
+		size = pipe->count;
+
+	// Copy up to the end of the ring, then from its start
+	size_t first = pipe->size - pipe->head;
+	if (first > size)
+		first = size;
+
+	memcpy(buf, pipe->data + pipe->head, first);
+	memcpy(buf + first, pipe->data, size - first);
+
+	pipe->head = (pipe->head + size) & (pipe->size - 1);
+	pipe->count -= size;
+
+	return size;
+}
+
+// Appends bytes to the pipe, the offset is ignored
+size_t writePipe(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	(void)offset;
+	pipe_t *pipe = pipeOf(node);
+
+	// Nobody reads after the read end got closed
+	if (node->openReadStreams == 0)
+		return 0;
+
+	if (pipe->size - pipe->count < size)
+		growPipe(pipe, pipe->count + size);
+
+	if (size > pipe->size - pipe->count)
+		size = pipe->size - pipe->count;
+
+	// Copy up to the end of the ring, then from its start
+	size_t tail = (pipe->head + pipe->count) & (pipe->size - 1);
+	size_t first = pipe->size - tail;
+	if (first > size)
+		first = size;
+
+	memcpy(pipe->data + tail, buf, first);
+	memcpy(pipe->data, buf + first, size - first);
+
+	pipe->count += size;
+
+	return size;
+}
+
+// Frees the pipe once both ends are closed
+void closePipe(file_desc_t *node)
+{
+	pipe_t *pipe = pipeOf(node);
+
+	kfree(pipe->data);
+	kfree(pipe);
+	kfree(node);
+}
+
+// Creates an empty pipe. The VFS opens both of its ends
+file_desc_t *pipeCreate()
+{
+	pipe_t *pipe = kzalloc(sizeof(pipe_t));
+	file_desc_t *node = kzalloc(sizeof(file_desc_t));
+
+	if (pipe)
+		pipe->data = kmalloc(PIPE_BUFFER_MIN);
+
+	if (!node || !pipe || !pipe->data)
+	{
+		if (pipe)
+			kfree(pipe->data);
+
+		kfree(pipe);
+		kfree(node);
+		return NULL;
+	}
+
+	pipe->size = PIPE_BUFFER_MIN;
+
+	strcpy(node->name, "pipe");
+	node->flags = FS_CHRDEVICE;
+	node->length = INT_MAX;
+	node->inode = (uint32_t)(uintptr_t)pipe;
+
+	node->read = &readPipe;
+	node->write = &writePipe;
+	node->close = &closePipe;
+
+	return node;
+}
@@ -0,0 +1,365 @@
+#include <vfs/procfs.h>
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <memory/heap.h>
+#include <memory/pmm.h>
+#include <vfs/pagecache.h>
+#include <hal/atapio.h>
+#include <hal/pit.h>
+#include <ld-owos/ld-owos.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Output of a file generator, appended to with textPrintf
+typedef struct proc_text_t
+{
+	char *buf;
+	size_t size;
+	size_t length;
+} proc_text_t;
+
+// A file of the procfs and the function generating its content
+// (the inode number of a file is its index inside the file table plus one)
+typedef struct proc_file_t
+{
+	const char *name;
+	void (*generate)(proc_text_t *text);
+} proc_file_t;
+
+//------------------------------------------------------------------------------------------
+//				Private function declarations
+//------------------------------------------------------------------------------------------
+
+static void textPrintf(proc_text_t *text, const char *format, ...);
+static size_t generate(const proc_file_t *file, char *buf);
+
+static void generateMeminfo(proc_text_t *text);
+static void generateAta(proc_text_t *text);
+static void generateVfs(proc_text_t *text);
+static void generateLibs(proc_text_t *text);
+static void generateExec(proc_text_t *text);
+static void generateUptime(proc_text_t *text);
+
+static void setCallbacks(file_desc_t *file);
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+static const proc_file_t files[] =
+{
+	{ "meminfo", generateMeminfo },
+	{ "ata",     generateAta },
+	{ "vfs",     generateVfs },
+	{ "libs",    generateLibs },
+	{ "exec",    generateExec },
+	{ "uptime",  generateUptime },
+};
+
+static const size_t fileCount = sizeof(files) / sizeof(files[0]);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+// Appends formatted text, output not fitting into the file is cut off
+static void textPrintf(proc_text_t *text, const char *format, ...)
+{
+	if (text->length + 1 >= text->size)
+		return;
+
+	va_list ap;
+	va_start(ap, format);
+	int length = vsnprintf(text->buf + text->length, text->size - text->length, format, ap);
+	va_end(ap);
+
+	if (length < 0)
+		return;
+
+	text->length += (size_t)length;
+	if (text->length >= text->size)
+		text->length = text->size - 1;
+}
+
+// Generates the content of the file into the buffer (PROCFS_FILE_MAX bytes)
+// Returns the length of the content
+static size_t generate(const proc_file_t *file, char *buf)
+{
+	proc_text_t text = { buf, PROCFS_FILE_MAX, 0 };
+	file->generate(&text);
+
+	return text.length;
+}
+
+static void generateMeminfo(proc_text_t *text)
+{
+	heap_stats_t heap;
+	pmm_stats_t pmm;
+	pagecache_stats_t cache;
+
+	heapGetStats(&heap);
+	pmmGetStats(&pmm);
+	pagecacheGetStats(&cache);
+
+	textPrintf(text, "HeapLive:        %u bytes\n", heap.liveBytes);
+	textPrintf(text, "HeapPeak:        %u bytes\n", heap.peakBytes);
+	textPrintf(text, "HeapObjects:     %u\n", heap.liveObjects);
+	textPrintf(text, "HeapAllocs:      %u\n", heap.allocations);
+	textPrintf(text, "HeapFrees:       %u\n", heap.frees);
+	textPrintf(text, "HeapFailed:      %u\n", heap.failed);
+	textPrintf(text, "HeapChunks:      %u (%u bytes)\n", heap.chunks, heap.chunkBytes);
+	textPrintf(text, "HeapFree:        %u bytes\n", heap.freeBytes);
+	textPrintf(text, "HeapLargestFree: %u bytes\n", heap.largestFree);
+	textPrintf(text, "HeapFragment:    %u%%\n", heap.fragmentation);
+	textPrintf(text, "BlockSize:       %u bytes\n", PMM_BLOCK_SIZE);
+	textPrintf(text, "BlocksTotal:     %u\n", pmm.totalBlocks);
+	textPrintf(text, "BlocksUsed:      %u\n", pmm.usedBlocks);
+	textPrintf(text, "BlocksFree:      %u\n", pmm.totalBlocks - pmm.usedBlocks);
+	textPrintf(text, "BlocksPeak:      %u\n", pmm.peakUsedBlocks);
+	textPrintf(text, "BlocksZeroed:    %u\n", pmm.zeroedBlocks);
+	textPrintf(text, "LargestFreeRun:  %u blocks\n", pmm.largestFreeRun);
+	textPrintf(text, "CachePages:      %u\n", cache.pages);
+	textPrintf(text, "CacheDirty:      %u\n", cache.dirtyPages);
+	textPrintf(text, "CacheHits:       %u\n", cache.hits);
+	textPrintf(text, "CacheMisses:     %u\n", cache.misses);
+	textPrintf(text, "CacheReads:      %u\n", cache.reads);
+	textPrintf(text, "CacheEvictions:  %u\n", cache.evictions);
+	textPrintf(text, "CacheWritebacks: %u\n", cache.writebacks);
+}
+
+static void generateAta(proc_text_t *text)
+{
+	textPrintf(text, "drive  reads      sectors    writes     sectors    errors\n");
+
+	for (uint8_t i = 0; i < ATA_MAX_DRIVES; i++)
+	{
+		if (!getDrive(i).inserted)
+			continue;
+
+		ata_stats_t stats;
+		ataGetStats(i, &stats);
+
+		textPrintf(text, "%-6u %-10u %-10u %-10u %-10u %u\n", i, stats.reads, stats.sectorsRead, stats.writes, stats.sectorsWritten, stats.errors);
+	}
+}
+
+static void generateVfs(proc_text_t *text)
+{
+	vfs_stats_t stats;
+	vfsGetStats(&stats);
+
+	textPrintf(text, "Nodes:         %u\n", stats.nodes);
+	textPrintf(text, "NodeBudget:    %u\n", stats.nodeBudget);
+	textPrintf(text, "PooledBuffers: %u\n", stats.pooledBuffers);
+}
+
+// Lists the libraries of the running program (the reading program itself)
+static void generateLibs(proc_text_t *text)
+{
+	for (size_t i = 0; i < loaded_lib_count; i++)
+	{
+		libinfo_t *lib = loaded_libs[i];
+		textPrintf(text, "0x%.8x %-5u %s\n", (uintptr_t)lib->base_address, lib->page_count, LIBINFO_NAME(lib));
+	}
+}
+
+// Time from the start of the linker to the entry of the program.
+// Cold launches load the executable from its file, warm ones start its cached image.
+// Static executables are loaded without the dynamic linker
+static void generateExec(proc_text_t *text)
+{
+	linker_stats_t stats;
+	linker_get_stats(&stats);
+
+	textPrintf(text, "CachedImages:    %u\n", stats.images);
+	textPrintf(text, "ColdLaunches:    %u\n", stats.cold_launches);
+	textPrintf(text, "ColdAverage:     %u us\n", stats.cold_launches ? stats.cold_ticks * 1000 / stats.cold_launches : 0);
+	textPrintf(text, "WarmLaunches:    %u\n", stats.warm_launches);
+	textPrintf(text, "WarmAverage:     %u us\n", stats.warm_launches ? stats.warm_ticks * 1000 / stats.warm_launches : 0);
+	textPrintf(text, "StaticLaunches:  %u\n", stats.static_launches);
+	textPrintf(text, "StaticAverage:   %u us\n", stats.static_launches ? stats.static_ticks * 1000 / stats.static_launches : 0);
+}
+
+// The PIT ticks every millisecond
+static void generateUptime(proc_text_t *text)
+{
+	uint32_t ticks = getTicks();
+	textPrintf(text, "%u.%.3u s (%u ticks)\n", ticks / 1000, ticks % 1000, ticks);
+}
+
+static void setCallbacks(file_desc_t *file)
+{
+	if (file->flags & FS_FILE)
+	{
+		file->read = (read_callback)readProcfs;
+		file->write = (write_callback)writeProcfs;
+	}
+	else
+	{
+		file->findfile = (findfile_callback)findfileProcfs;
+		file->mkfile = (mkfile_callback)mkfileProcfs;
+		file->rmfile = (rmfile_callback)rmfileProcfs;
+		file->readdir = (readdir_callback)readdirProcfs;
+	}
+
+	file->rename = (rename_callback)renameProcfs;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Generates the file and copies the requested part of it.
+// The stream buffers hold a whole file, so a file normally gets generated once per read
+size_t readProcfs(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	char *content = kmalloc(PROCFS_FILE_MAX);
+
+	if (!content)
+		return 0;
+
+	size_t length = generate(&files[node->inode - 1], content);
+	node->length = length;
+
+	if (offset >= length)
+	{
+		kfree(content);
+		return 0;
+	}
+
+	if (size > length - offset)
+		size = length - offset;
+
+	memcpy(buf, content + offset, size);
+	kfree(content);
+
+	return size;
+}
+
+// The files are read-only
+size_t writeProcfs(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	(void)node;
+	(void)offset;
+	(void)size;
+	(void)buf;
+
+	return 0;
+}
+
+int readdirProcfs(DIR *dirstream)
+{
+	if (dirstream->index >= fileCount)
+		return EOF;
+
+	strcpy(dirstream->entry.d_name, files[dirstream->index].name);
+	dirstream->entry.d_ino = dirstream->index + 1;
+	dirstream->entry.d_type = DT_REG;
+
+	return 0;
+}
+
+file_desc_t *findfileProcfs(file_desc_t *node, char *name, bool *missing)
+{
+	for (size_t i = 0; i < fileCount; i++)
+	{
+		if (strcmp(files[i].name, name) != 0)
+			continue;
+
+		file_desc_t *file = kzalloc(sizeof(file_desc_t));
+		char *content = kmalloc(PROCFS_FILE_MAX);
+
+		if (!file || !content)
+		{
+			kfree(file);
+			kfree(content);
+			return NULL;
+		}
+
+		// The length is a snapshot, reads generate the file again
+		strcpy(file->name, files[i].name);
+		file->flags = FS_FILE;
+		file->length = generate(&files[i], content);
+		file->inode = i + 1;
+		file->mount = node->mount;
+		file->parent = node;
+		setCallbacks(file);
+
+		kfree(content);
+		return file;
+	}
+
+	*missing = true;
+	return NULL;
+}
+
+// The file table is fixed
+int mkfileProcfs(file_desc_t *file)
+{
+	(void)file;
+	return EOF;
+}
+
+int rmfileProcfs(file_desc_t *file)
+{
+	(void)file;
+	return EOF;
+}
+
+int renameProcfs(file_desc_t *file, file_desc_t *newParent, char *origName)
+{
+	(void)file;
+	(void)newParent;
+	(void)origName;
+	return EOF;
+}
+
+mountpoint_t *mountProcfs()
+{
+	mountpoint_t *mount = kzalloc(sizeof(mountpoint_t));
+	file_desc_t *rootdir = kzalloc(sizeof(file_desc_t));
+
+	if (!mount || !rootdir)
+	{
+		debug_set_color(0x0C, 0x00);
+		debug_print("Couldn't allocate procfs");
+		debug_set_color(0x0F, 0x00);
+
+		kfree(rootdir);
+		kfree(mount);
+		return NULL;
+	}
+
+	// Create root file descriptor
+	rootdir->flags = FS_DIRECTORY;
+	rootdir->mount = mount;
+	rootdir->inode = 0;
+	setCallbacks(rootdir);
+
+	// Create the mountpoint
+	// The files change with every read, so they must not be cached
+	mount->root = rootdir;
+	mount->partition = NULL;
+	mount->metadata = 0;
+	mount->blockSize = PROCFS_FILE_MAX;
+	mount->flags = MNT_NOCACHE;
+	mount->unmount = (unmount_callback)unmountProcfs;
+
+	return mount;
+}
+
+// There is no metadata to clear
+void unmountProcfs(mountpoint_t *mountpoint)
+{
+	(void)mountpoint;
+}
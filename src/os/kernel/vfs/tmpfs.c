@@ -0,0 +1,573 @@
+#include <vfs/tmpfs.h>
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <memory/heap.h>
+#include <memory/pmm.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define PAGE_SIZE PMM_BLOCK_SIZE // File data is stored in PMM blocks
+
+#define DIR_BUCKETS_MIN 8 // Initial amount of buckets of a directory (has to be a power of two)
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// A file or directory in memory
+// (the inode number of its file descriptors is the address of the inode)
+typedef struct tmpfs_inode_t
+{
+	char name[FILENAME_MAX + 1];
+	uint32_t flags; // FS_FILE or FS_DIRECTORY
+	uint32_t hash;  // Hash of the name
+
+	struct tmpfs_inode_t *parent; // Directory the inode lies in
+
+	// File data
+	size_t length;
+	char **pages;     // One PMM block per page of the file
+	size_t pageCount; // Slots of the page array
+
+	// Directory entries, hashed by name and listed in creation order for readdir
+	struct tmpfs_inode_t **buckets;
+	size_t bucketCount; // Power of two
+	size_t entryCount;
+	struct tmpfs_inode_t *first;
+	struct tmpfs_inode_t *last;
+
+	// Last entry returned by readdir, so listing a directory stays linear
+	struct tmpfs_inode_t *cursor;
+	size_t cursorIndex;
+
+	struct tmpfs_inode_t *hashNext; // Next entry in the same bucket of the parent
+	struct tmpfs_inode_t *prev;     // Previous entry in the list of the parent
+	struct tmpfs_inode_t *next;     // Next entry in the list of the parent
+} tmpfs_inode_t;
+
+// Metadata of a mounted tmpfs
+typedef struct tmpfs_metadata_t
+{
+	tmpfs_inode_t *root;
+	tmpfs_stats_t stats;
+} tmpfs_metadata_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------------------
+//				Private function declarations
+//------------------------------------------------------------------------------------------
+
+static inline tmpfs_inode_t *inodeOf(file_desc_t *file);
+static inline tmpfs_metadata_t *metadataOf(file_desc_t *file);
+
+static uint32_t hashName(const char *name, size_t len);
+static tmpfs_inode_t *lookupEntry(tmpfs_inode_t *dir, const char *name, uint32_t hash);
+static int growBuckets(tmpfs_inode_t *dir);
+static int insertEntry(tmpfs_inode_t *dir, tmpfs_inode_t *inode);
+static void removeEntry(tmpfs_inode_t *dir, tmpfs_inode_t *inode);
+
+static tmpfs_inode_t *allocInode(const char *name, uint32_t flags);
+static void freeInode(tmpfs_metadata_t *metadata, tmpfs_inode_t *inode);
+static int growPages(tmpfs_inode_t *inode, size_t count);
+
+static void setCallbacks(file_desc_t *file);
+static file_desc_t *createFileDesc(file_desc_t *parent, tmpfs_inode_t *inode);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+static inline tmpfs_inode_t *inodeOf(file_desc_t *file)
+{
+	return (tmpfs_inode_t*)(uintptr_t)file->inode;
+}
+
+static inline tmpfs_metadata_t *metadataOf(file_desc_t *file)
+{
+	return (tmpfs_metadata_t*)file->mount->metadata;
+}
+
+// FNV-1a hash of a filename
+static uint32_t hashName(const char *name, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// Finds an entry of the directory by its name
+static tmpfs_inode_t *lookupEntry(tmpfs_inode_t *dir, const char *name, uint32_t hash)
+{
+	if (!dir->buckets)
+		return NULL;
+
+	tmpfs_inode_t *entry = dir->buckets[hash & (dir->bucketCount - 1)];
+
+	for (; entry; entry = entry->hashNext)
+	{
+		if (entry->hash == hash && strcmp(entry->name, name) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+// Doubles the amount of buckets of the directory
+static int growBuckets(tmpfs_inode_t *dir)
+{
+	size_t newCount = dir->bucketCount ? dir->bucketCount * 2 : DIR_BUCKETS_MIN;
+	tmpfs_inode_t **newBuckets = kcalloc(newCount, sizeof(tmpfs_inode_t*));
+
+	if (!newBuckets)
+		return EOF;
+
+	// Rehash the entries
+	for (tmpfs_inode_t *entry = dir->first; entry; entry = entry->next)
+	{
+		size_t bucket = entry->hash & (newCount - 1);
+		entry->hashNext = newBuckets[bucket];
+		newBuckets[bucket] = entry;
+	}
+
+	if (dir->buckets)
+		kfree(dir->buckets);
+
+	dir->buckets = newBuckets;
+	dir->bucketCount = newCount;
+
+	return 0;
+}
+
+// Links the inode into the bucket and at the end of the entry list of the directory
+static int insertEntry(tmpfs_inode_t *dir, tmpfs_inode_t *inode)
+{
+	// Keep at most one entry per bucket on average
+	if (dir->entryCount + 1 > dir->bucketCount && growBuckets(dir))
+		return EOF;
+
+	size_t bucket = inode->hash & (dir->bucketCount - 1);
+	inode->hashNext = dir->buckets[bucket];
+	dir->buckets[bucket] = inode;
+
+	inode->prev = dir->last;
+	inode->next = NULL;
+
+	if (dir->last)
+		dir->last->next = inode;
+	else
+		dir->first = inode;
+
+	dir->last = inode;
+	dir->entryCount++;
+	inode->parent = dir;
+
+	return 0;
+}
+
+// Unlinks the inode from the directory
+static void removeEntry(tmpfs_inode_t *dir, tmpfs_inode_t *inode)
+{
+	tmpfs_inode_t **link = &dir->buckets[inode->hash & (dir->bucketCount - 1)];
+	while (*link != inode)
+		link = &(*link)->hashNext;
+
+	*link = inode->hashNext;
+
+	if (inode->prev) inode->prev->next = inode->next;
+	else dir->first = inode->next;
+
+	if (inode->next) inode->next->prev = inode->prev;
+	else dir->last = inode->prev;
+
+	dir->entryCount--;
+
+	// The indices of the following entries changed
+	dir->cursor = NULL;
+
+	inode->hashNext = NULL;
+	inode->prev = NULL;
+	inode->next = NULL;
+	inode->parent = NULL;
+}
+
+static tmpfs_inode_t *allocInode(const char *name, uint32_t flags)
+{
+	tmpfs_inode_t *inode = kzalloc(sizeof(tmpfs_inode_t));
+
+	if (!inode)
+		return NULL;
+
+	strncpy(inode->name, name, FILENAME_MAX);
+	inode->hash = hashName(inode->name, strlen(inode->name));
+	inode->flags = flags;
+
+	return inode;
+}
+
+// Frees the inode with its data and all entries below it
+static void freeInode(tmpfs_metadata_t *metadata, tmpfs_inode_t *inode)
+{
+	for (tmpfs_inode_t *entry = inode->first, *next; entry; entry = next)
+	{
+		next = entry->next;
+		freeInode(metadata, entry);
+		metadata->stats.files--;
+	}
+
+	for (size_t i = 0; i < inode->pageCount; i++)
+	{
+		if (inode->pages[i])
+		{
+			pmmFree(inode->pages[i]);
+			metadata->stats.pages--;
+		}
+	}
+
+	if (inode->pages)
+		kfree(inode->pages);
+
+	if (inode->buckets)
+		kfree(inode->buckets);
+
+	kfree(inode);
+}
+
+// Makes the page array hold at least count pages
+static int growPages(tmpfs_inode_t *inode, size_t count)
+{
+	if (count <= inode->pageCount)
+		return 0;
+
+	size_t newCount = inode->pageCount ? inode->pageCount : 1;
+	while (newCount < count)
+		newCount *= 2;
+
+	char **newPages = krealloc(inode->pages, newCount * sizeof(char*));
+
+	if (!newPages)
+		return EOF;
+
+	memset(newPages + inode->pageCount, 0, (newCount - inode->pageCount) * sizeof(char*));
+
+	inode->pages = newPages;
+	inode->pageCount = newCount;
+
+	return 0;
+}
+
+static void setCallbacks(file_desc_t *file)
+{
+	if (file->flags & FS_FILE)
+	{
+		file->read = (read_callback)readTmpfs;
+		file->write = (write_callback)writeTmpfs;
+	}
+	else
+	{
+		file->findfile = (findfile_callback)findfileTmpfs;
+		file->mkfile = (mkfile_callback)mkfileTmpfs;
+		file->rmfile = (rmfile_callback)rmfileTmpfs;
+		file->readdir = (readdir_callback)readdirTmpfs;
+	}
+
+	file->rename = (rename_callback)renameTmpfs;
+}
+
+// Creates a file descriptor for the VFS describing the inode
+static file_desc_t *createFileDesc(file_desc_t *parent, tmpfs_inode_t *inode)
+{
+	file_desc_t *file = kzalloc(sizeof(file_desc_t));
+
+	if (!file)
+		return NULL;
+
+	strcpy(file->name, inode->name);
+	file->flags = inode->flags;
+	file->length = inode->length;
+	file->inode = (uint32_t)(uintptr_t)inode;
+	file->mount = parent->mount;
+	file->parent = parent;
+
+	setCallbacks(file);
+
+	return file;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+size_t readTmpfs(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	tmpfs_inode_t *inode = inodeOf(node);
+
+	if (offset >= inode->length)
+		return 0;
+
+	if (size > inode->length - offset)
+		size = inode->length - offset;
+
+	for (size_t done = 0; done < size;)
+	{
+		size_t pos = offset + done;
+		size_t start = pos % PAGE_SIZE;
+		size_t amount = PAGE_SIZE - start;
+		if (amount > size - done)
+			amount = size - done;
+
+		memcpy(buf + done, inode->pages[pos / PAGE_SIZE] + start, amount);
+		done += amount;
+	}
+
+	return size;
+}
+
+// Writes into the pages of the file, pages get allocated as the file grows
+size_t writeTmpfs(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	tmpfs_inode_t *inode = inodeOf(node);
+	tmpfs_metadata_t *metadata = metadataOf(node);
+
+	// Files can't have holes
+	if (size == 0 || offset > inode->length)
+		return 0;
+
+	if (growPages(inode, (offset + size + PAGE_SIZE - 1) / PAGE_SIZE))
+		return 0;
+
+	size_t done = 0;
+
+	while (done < size)
+	{
+		size_t pos = offset + done;
+		size_t start = pos % PAGE_SIZE;
+		size_t amount = PAGE_SIZE - start;
+		if (amount > size - done)
+			amount = size - done;
+
+		char **page = &inode->pages[pos / PAGE_SIZE];
+
+		if (!*page)
+		{
+			*page = pmmAlloc();
+
+			if (!*page)
+			{
+				debug_set_color(0x0C, 0x00);
+				debug_print("[TMPFS] Out of memory!");
+				debug_set_color(0x0F, 0x00);
+				break;
+			}
+
+			metadata->stats.pages++;
+		}
+
+		memcpy(*page + start, buf + done, amount);
+		done += amount;
+	}
+
+	// Update file length
+	if (offset + done > inode->length)
+	{
+		inode->length = offset + done;
+		node->length = inode->length;
+	}
+
+	return done;
+}
+
+int readdirTmpfs(DIR *dirstream)
+{
+	tmpfs_inode_t *dir = inodeOf(dirstream->dirfile);
+
+	// Continue behind the last entry returned if possible
+	tmpfs_inode_t *entry = dir->first;
+	size_t index = 0;
+
+	if (dir->cursor && dir->cursorIndex <= dirstream->index)
+	{
+		entry = dir->cursor;
+		index = dir->cursorIndex;
+	}
+
+	for (; entry && index < dirstream->index; index++)
+		entry = entry->next;
+
+	if (!entry)
+		return EOF;
+
+	dir->cursor = entry;
+	dir->cursorIndex = index;
+
+	strcpy(dirstream->entry.d_name, entry->name);
+	dirstream->entry.d_ino = (uint32_t)(uintptr_t)entry;
+	dirstream->entry.d_type = entry->flags & FS_DIRECTORY ? DT_DIR : DT_REG;
+
+	return 0;
+}
+
+file_desc_t *findfileTmpfs(file_desc_t *node, char *name, bool *missing)
+{
+	tmpfs_inode_t *entry = lookupEntry(inodeOf(node), name, hashName(name, strlen(name)));
+
+	if (!entry)
+	{
+		*missing = true;
+		return NULL;
+	}
+
+	return createFileDesc(node, entry);
+}
+
+int mkfileTmpfs(file_desc_t *file)
+{
+	tmpfs_inode_t *dir = inodeOf(file->parent);
+
+	// The name is already taken
+	if (lookupEntry(dir, file->name, hashName(file->name, strlen(file->name))))
+		return EOF;
+
+	tmpfs_inode_t *inode = allocInode(file->name, file->flags & (FS_FILE | FS_DIRECTORY));
+
+	if (!inode)
+		return EOF;
+
+	if (insertEntry(dir, inode))
+	{
+		kfree(inode);
+		return EOF;
+	}
+
+	metadataOf(file)->stats.files++;
+
+	file->length = 0;
+	file->inode = (uint32_t)(uintptr_t)inode;
+	setCallbacks(file);
+
+	return 0;
+}
+
+int rmfileTmpfs(file_desc_t *file)
+{
+	tmpfs_inode_t *inode = inodeOf(file);
+
+	// Directories have to be empty
+	if (inode->entryCount > 0)
+		return EOF;
+
+	tmpfs_metadata_t *metadata = metadataOf(file);
+
+	removeEntry(inode->parent, inode);
+	freeInode(metadata, inode);
+	metadata->stats.files--;
+
+	return 0;
+}
+
+// The new name is already set in the file descriptor
+int renameTmpfs(file_desc_t *file, file_desc_t *newParent, char *origName)
+{
+	tmpfs_inode_t *inode = inodeOf(file);
+	tmpfs_inode_t *newDir = inodeOf(newParent);
+
+	if (lookupEntry(newDir, file->name, hashName(file->name, strlen(file->name))))
+		return EOF;
+
+	// A directory can't be moved into itself
+	for (tmpfs_inode_t *dir = newDir; dir; dir = dir->parent)
+	{
+		if (dir == inode)
+			return EOF;
+	}
+
+	tmpfs_inode_t *oldDir = inode->parent;
+	removeEntry(oldDir, inode);
+
+	strcpy(inode->name, file->name);
+	inode->hash = hashName(inode->name, strlen(inode->name));
+
+	if (insertEntry(newDir, inode))
+	{
+		// Restore the old entry
+		strcpy(inode->name, origName);
+		inode->hash = hashName(inode->name, strlen(inode->name));
+		insertEntry(oldDir, inode);
+		return EOF;
+	}
+
+	return 0;
+}
+
+// Creates an empty filesystem in memory
+mountpoint_t *mountTmpfs()
+{
+	mountpoint_t *mount = kzalloc(sizeof(mountpoint_t));
+	tmpfs_metadata_t *metadata = kzalloc(sizeof(tmpfs_metadata_t));
+	file_desc_t *rootdir = kzalloc(sizeof(file_desc_t));
+
+	if (metadata)
+		metadata->root = allocInode("", FS_DIRECTORY);
+
+	if (!mount || !metadata || !metadata->root || !rootdir)
+	{
+		debug_set_color(0x0C, 0x00);
+		debug_print("Couldn't allocate tmpfs");
+		debug_set_color(0x0F, 0x00);
+
+		if (metadata && metadata->root)
+			kfree(metadata->root);
+
+		kfree(metadata);
+		kfree(rootdir);
+		kfree(mount);
+		return NULL;
+	}
+
+	// Create root file descriptor
+	rootdir->flags = FS_DIRECTORY;
+	rootdir->mount = mount;
+	rootdir->inode = (uint32_t)(uintptr_t)metadata->root;
+	setCallbacks(rootdir);
+
+	// Create the mountpoint
+	// The data already lies in memory, so it doesn't go through the page cache
+	mount->root = rootdir;
+	mount->partition = NULL;
+	mount->metadata = (uintptr_t)metadata;
+	mount->blockSize = PAGE_SIZE;
+	mount->flags = MNT_NOCACHE;
+	mount->unmount = (unmount_callback)unmountTmpfs;
+
+	return mount;
+}
+
+// Unmount the filesystem by freeing all files
+void unmountTmpfs(mountpoint_t *mountpoint)
+{
+	tmpfs_metadata_t *metadata = (tmpfs_metadata_t*)mountpoint->metadata;
+	freeInode(metadata, metadata->root);
+	kfree(metadata);
+}
+
+void tmpfsGetStats(mountpoint_t *mountpoint, tmpfs_stats_t *stats)
+{
+	*stats = ((tmpfs_metadata_t*)mountpoint->metadata)->stats;
+}
@@ -5,13 +5,18 @@
 //------------------------------------------------------------------------------------------
 
 #include <memory/heap.h>
+#include <memory/pmm.h>
 #include <hal/atapio.h>
 #include <vfs/mbr.h>
 #include <vfs/pathutils.h>
+#include <vfs/pagecache.h>
 #include <string.h>
 #include <debug.h>
 
 #include <vfs/fat32.h>
+#include <vfs/tmpfs.h>
+#include <vfs/procfs.h>
+#include <vfs/pipe.h>
 
 //------------------------------------------------------------------------------------------
 //				Constants
@@ -20,10 +25,32 @@
 // Private file flags
 #define ORIGBUF  0x40000000 // Original buffer still present (gets cleared on vfsSetvbuf)
 
+// Child tables of directory nodes
+#define CHILD_TABLE_MIN 8 // Initial amount of slots (has to be a power of two)
+
+// Failed lookups remembered per directory
+#define MISSING_CACHE_SIZE 8
+
+// Nodes kept in memory besides the root node before cold ones get evicted
+#define VFS_NODE_BUDGET 128
+
+// Driver-managed stream buffers (split into a read and a write half)
+#define STREAM_BUFFER_MAX   (32 * 1024) // Largest buffer a sequential stream grows to
+#define STREAM_GROW_AFTER   4           // Sequential refills before the buffer size doubles
+#define BUFFER_POOL_CLASSES 6           // Power of two sizes from BUFSIZ to STREAM_BUFFER_MAX
+#define BUFFER_POOL_DEPTH   4           // Free buffers kept per size
+
 //------------------------------------------------------------------------------------------
 //				Types
 //------------------------------------------------------------------------------------------
 
+// A name that doesn't exist inside a directory
+typedef struct missing_entry_t
+{
+	uint32_t hash;
+	char *name; // NULL if the entry is unused
+} missing_entry_t;
+
 // Datastructure to represent the node graph of the filesystem currently in memory
 typedef struct vfs_node_t
 {
@@ -40,6 +67,24 @@ typedef struct vfs_node_t
 	// (applies if there are more files inside the directory this file resides in)
 	struct vfs_node_t *prev;
 	struct vfs_node_t *next;
+
+	uint32_t hash; // Hash of the filename
+
+	// Open addressing hash table of the children in memory
+	// (linear probing on the filename hash, allocated with the first child)
+	struct vfs_node_t **table;
+	size_t tableSize;  // Amount of slots (power of two)
+	size_t childCount; // Amount of children in memory
+
+	// Names the filesystem driver didn't find in this directory
+	// (allocated with the first miss, replaced round robin)
+	missing_entry_t *missing;
+	size_t missingNext; // Entry to be replaced next
+
+	// Position in the list of all nodes sorted by their last use
+	// (the root node is never part of it)
+	struct vfs_node_t *lruPrev;
+	struct vfs_node_t *lruNext;
 } vfs_node_t;
 
 //------------------------------------------------------------------------------------------
@@ -49,151 +94,478 @@ typedef struct vfs_node_t
 // Root node of the vfs node graph
 static vfs_node_t *root;
 
+// Least recently used list of the nodes besides the root node
+static vfs_node_t *lruHead; // Most recently used
+static vfs_node_t *lruTail; // Least recently used
+static size_t nodeCount = 0;
+
+// Source of the file versions, so a recreated node never gets the version of an older one
+static uint32_t lastVersion = 0;
+
+// Free stream buffers by size class, so opening a file doesn't hit the heap
+static char *bufferPool[BUFFER_POOL_CLASSES][BUFFER_POOL_DEPTH];
+static size_t bufferPoolCount[BUFFER_POOL_CLASSES];
+
 //------------------------------------------------------------------------------------------
 //				Private function declarations
 //------------------------------------------------------------------------------------------
 
-static vfs_node_t *findfile_helper(vfs_node_t *node, char *path);
-static vfs_node_t *findfile(vfs_node_t *node, const char *path);
+static uint32_t hashName(const char *name, size_t len);
+static vfs_node_t *lookupChild(vfs_node_t *dir, const char *name, size_t len, uint32_t hash);
+static missing_entry_t *lookupMissing(vfs_node_t *dir, const char *name, size_t len, uint32_t hash);
+static void addMissing(vfs_node_t *dir, const char *name, size_t len, uint32_t hash);
+static void forgetMissing(vfs_node_t *dir, const char *name, size_t len);
+static int growChildTable(vfs_node_t *dir);
+static int insertChild(vfs_node_t *dir, vfs_node_t *child);
+static void removeChild(vfs_node_t *dir, vfs_node_t *child);
+static vfs_node_t *allocNode(file_desc_t *file);
+static void touchNode(vfs_node_t *node);
+static void freeNode(vfs_node_t *node);
+
+static vfs_node_t *findChild(vfs_node_t *node, const char *name, size_t length);
+static vfs_node_t *findfile(vfs_node_t *node, const char *path, size_t length);
 static vfs_node_t *createFile(vfs_node_t *node, const char *path, uint32_t flags);
 
-static int cleanupTreeHelper(vfs_node_t *node);
-static void cleanupTree();
+static bool isMountRoot(vfs_node_t *node);
+static bool isEvictable(vfs_node_t *node);
+static void evictNodes();
+
+static int mountAt(const char *path, mountpoint_t *mount);
+
+static inline bool isCached(file_desc_t *file);
+static size_t readFile(file_desc_t *file, size_t offset, size_t size, char *buf);
+static size_t writeFile(file_desc_t *file, size_t offset, size_t size, char *buf);
+static size_t readFileV(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt);
+static size_t writeFileV(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt);
+static size_t vectorSize(const struct iovec *iov, int iovcnt);
+static int writeBuffer(FILE *file);
+static void dropReadAhead(FILE *file);
+
+static int bufferClass(size_t size);
+static char *allocStreamBuffer(size_t size);
+static void freeStreamBuffer(char *buf, size_t size);
+static size_t streamBufferSize(file_desc_t *file);
+static void setStreamBuffer(FILE *file, char *buf, size_t size);
+static void growStreamBuffer(FILE *file);
 
 static uint8_t parseModeString(const char *mode);
+static FILE *openStream(file_desc_t *desc, const char *mode);
 
 //------------------------------------------------------------------------------------------
 //				Private function implementations
 //------------------------------------------------------------------------------------------
 
-// Helper function to recursively free unused nodes
-static int cleanupTreeHelper(vfs_node_t *node)
+// FNV-1a hash of a filename
+static uint32_t hashName(const char *name, size_t len)
 {
-	int ret = 0;
+	uint32_t hash = 2166136261u;
 
-	// Recursively try to free subdirectories
-	if (node->child)
+	for (size_t i = 0; i < len; i++)
 	{
-		for (vfs_node_t *child = node->child; child != NULL; child = child->next)
-			ret += cleanupTreeHelper(child);
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619u;
 	}
 
-	// Check if the file is being written/read
-	if (node->file_desc->openReadStreams > 0 || node->file_desc->openWriteStreams > 0)
-		ret = 1;
+	return hash;
+}
+
+// Finds a child of the directory node by its name
+static vfs_node_t *lookupChild(vfs_node_t *dir, const char *name, size_t len, uint32_t hash)
+{
+	if (!dir->table)
+		return NULL;
+
+	size_t mask = dir->tableSize - 1;
 
-	// File is ready to be cleared (except root node)
-	if (!ret && node != root)
+	// Probe until an empty slot is hit
+	for (size_t i = hash & mask; dir->table[i]; i = (i + 1) & mask)
 	{
-		// Unlink file
-		if (node->parent)
-			node->parent->child = node->next;
-		
-		if (node->next)
-			node->next->prev = NULL;
-	
-		// Free used memory
-		kfree(node->file_desc);
-		kfree(node);
+		vfs_node_t *child = dir->table[i];
+
+		if (child->hash == hash && strncmp(child->file_desc->name, name, len) == 0 && child->file_desc->name[len] == '\0')
+			return child;
 	}
 
-	return ret;
+	return NULL;
 }
 
-// Recursively tries to free unused nodes inside the node tree
-static void cleanupTree()
+// Finds a name inside the failed lookups of the directory node
+static missing_entry_t *lookupMissing(vfs_node_t *dir, const char *name, size_t len, uint32_t hash)
 {
-	cleanupTreeHelper(root);
+	if (!dir->missing)
+		return NULL;
+
+	for (size_t i = 0; i < MISSING_CACHE_SIZE; i++)
+	{
+		missing_entry_t *entry = &dir->missing[i];
+
+		if (entry->name && entry->hash == hash && strncmp(entry->name, name, len) == 0 && entry->name[len] == '\0')
+			return entry;
+	}
+
+	return NULL;
 }
 
-// Helper function to recursively find a file inside the node tree
-static vfs_node_t *findfile_helper(vfs_node_t *node, char *path)
+// Remembers that the name doesn't exist inside the directory node
+static void addMissing(vfs_node_t *dir, const char *name, size_t len, uint32_t hash)
 {
-	// Get file string
-	char *file = getPathSubstr(path, 0);
-	if (!node) // Path is supposed to start at root dir
+	if (!dir->missing)
 	{
-		if (!file || file[0] == '\0') // Path starts at root dir
-		{
-			rmPathDirectory(path);
-			kfree(file);
-			return findfile_helper(root, path);
-		}
-		else // Invalid path (vfs driver only accepts absolute paths)
-		{
-			kfree(file);
-			return NULL;
-		}
+		dir->missing = kcalloc(MISSING_CACHE_SIZE, sizeof(missing_entry_t));
+
+		if (!dir->missing)
+			return;
 	}
 
-	// Correct node found
-	if (getPathLength(path) == 0)
+	char *copy = kstrndup(name, len);
+
+	if (!copy)
+		return;
+
+	missing_entry_t *entry = &dir->missing[dir->missingNext];
+	dir->missingNext = (dir->missingNext + 1) % MISSING_CACHE_SIZE;
+
+	if (entry->name)
+		kfree(entry->name);
+
+	entry->hash = hash;
+	entry->name = copy;
+}
+
+// Invalidates a failed lookup after a file with the name got created inside the directory
+static void forgetMissing(vfs_node_t *dir, const char *name, size_t len)
+{
+	missing_entry_t *entry = lookupMissing(dir, name, len, hashName(name, len));
+
+	if (entry)
 	{
-		kfree(file);
-		return node;
+		kfree(entry->name);
+		entry->name = NULL;
 	}
+}
+
+// Doubles the size of the child table of the directory node
+static int growChildTable(vfs_node_t *dir)
+{
+	size_t newSize = dir->tableSize ? dir->tableSize * 2 : CHILD_TABLE_MIN;
+	vfs_node_t **newTable = kcalloc(newSize, sizeof(vfs_node_t*));
+
+	if (!newTable)
+		return -1;
 
-	// Is the (new) node a directory?
-	if (!(node->file_desc->flags & FS_DIRECTORY))
+	// Rehash the children
+	for (vfs_node_t *child = dir->child; child; child = child->next)
 	{
-		kfree(file);
-		return NULL;
+		size_t i = child->hash & (newSize - 1);
+		while (newTable[i])
+			i = (i + 1) & (newSize - 1);
+
+		newTable[i] = child;
 	}
 
-	// Go to next subdirectory
-	rmPathDirectory(path);
+	if (dir->table)
+		kfree(dir->table);
+
+	dir->table = newTable;
+	dir->tableSize = newSize;
+
+	return 0;
+}
 
-	// Check for special characters
-	if (strcmp(file, "..") == 0)
+// Links a node into the child list and table of the directory node
+static int insertChild(vfs_node_t *dir, vfs_node_t *child)
+{
+	// Keep the load factor at 3/4 at most
+	if ((dir->childCount + 1) * 4 > dir->tableSize * 3)
 	{
-		kfree(file);
-		return findfile_helper(node->parent, path);
+		if (growChildTable(dir))
+			return -1;
 	}
-	if(strcmp(file, ".") == 0)
+
+	child->hash = hashName(child->file_desc->name, strlen(child->file_desc->name));
+	child->parent = dir;
+
+	size_t mask = dir->tableSize - 1;
+	size_t i = child->hash & mask;
+	while (dir->table[i])
+		i = (i + 1) & mask;
+
+	dir->table[i] = child;
+	dir->childCount++;
+
+	// Link node at the beginning of the child list
+	child->prev = NULL;
+	child->next = dir->child;
+
+	if (dir->child)
+		dir->child->prev = child;
+
+	dir->child = child;
+
+	return 0;
+}
+
+// Unlinks a node from the child list and table of the directory node
+static void removeChild(vfs_node_t *dir, vfs_node_t *child)
+{
+	if (dir->child == child)
+		dir->child = child->next;
+
+	if (child->next)
+		child->next->prev = child->prev;
+
+	if (child->prev)
+		child->prev->next = child->next;
+
+	child->next = NULL;
+	child->prev = NULL;
+
+	size_t mask = dir->tableSize - 1;
+	size_t i = child->hash & mask;
+	while (dir->table[i] != child)
+		i = (i + 1) & mask;
+
+	dir->table[i] = NULL;
+	dir->childCount--;
+
+	// Move following entries back so that no probe sequence gets interrupted
+	for (size_t next = (i + 1) & mask; dir->table[next]; next = (next + 1) & mask)
 	{
-		kfree(file);
-		return findfile_helper(node, path);
+		size_t home = dir->table[next]->hash & mask;
+
+		// Entry can't be moved into the hole if its home slot lies cyclically in (i, next]
+		if (((next - home) & mask) < ((next - i) & mask))
+			continue;
+
+		dir->table[i] = dir->table[next];
+		dir->table[next] = NULL;
+		i = next;
 	}
-	// Check if node is already in memory (recursively traverse node tree)
-	for (vfs_node_t *child = node->child; child; child = child->next)
+
+	// Free the table of empty directories
+	if (dir->childCount == 0)
 	{
-		if (strcmp(child->file_desc->name, file) == 0)
+		kfree(dir->table);
+		dir->table = NULL;
+		dir->tableSize = 0;
+	}
+}
+
+// Creates a node for the file as the most recently used one
+static vfs_node_t *allocNode(file_desc_t *file)
+{
+	vfs_node_t *node = kzalloc(sizeof(vfs_node_t));
+
+	if (!node)
+		return NULL;
+
+	node->file_desc = file;
+	file->version = ++lastVersion;
+
+	node->lruNext = lruHead;
+	if (lruHead)
+		lruHead->lruPrev = node;
+	else
+		lruTail = node;
+
+	lruHead = node;
+	nodeCount++;
+
+	return node;
+}
+
+// Marks the node as the most recently used one
+static void touchNode(vfs_node_t *node)
+{
+	if (isMountRoot(node) || node == lruHead)
+		return;
+
+	// Unlink from the current position
+	node->lruPrev->lruNext = node->lruNext;
+
+	if (node->lruNext)
+		node->lruNext->lruPrev = node->lruPrev;
+	else
+		lruTail = node->lruPrev;
+
+	// Link at the head
+	node->lruPrev = NULL;
+	node->lruNext = lruHead;
+	lruHead->lruPrev = node;
+	lruHead = node;
+}
+
+// Frees a node that is not linked anymore
+static void freeNode(vfs_node_t *node)
+{
+	// Cached pages may still refer to the file descriptor
+	if (node->file_desc->flags & FS_FILE)
+		pagecacheSync(node->file_desc);
+
+	if (!isMountRoot(node))
+	{
+		if (node->lruPrev) node->lruPrev->lruNext = node->lruNext;
+		else lruHead = node->lruNext;
+
+		if (node->lruNext) node->lruNext->lruPrev = node->lruPrev;
+		else lruTail = node->lruPrev;
+
+		nodeCount--;
+	}
+
+	if (node->table)
+		kfree(node->table);
+
+	if (node->missing)
+	{
+		for (size_t i = 0; i < MISSING_CACHE_SIZE; i++)
 		{
-			kfree(file);
-			return findfile_helper(child, path);
+			if (node->missing[i].name)
+				kfree(node->missing[i].name);
 		}
+
+		kfree(node->missing);
 	}
 
+	kfree(node->file_desc);
+	kfree(node);
+}
+
+// Roots of mounted filesystems are never part of the LRU list
+static bool isMountRoot(vfs_node_t *node)
+{
+	return node == root || node->file_desc == node->file_desc->mount->root;
+}
+
+// Only leaves of the node tree without open streams can be evicted
+static bool isEvictable(vfs_node_t *node)
+{
+	return !isMountRoot(node)
+		&& !node->child
+		&& node->file_desc->openReadStreams == 0
+		&& node->file_desc->openWriteStreams == 0;
+}
+
+// Frees the least recently used nodes until the node budget is met.
+// Evicting a leaf may turn its parent into one, so cold directories
+// follow once all of their cached entries are gone
+static void evictNodes()
+{
+	while (nodeCount > VFS_NODE_BUDGET)
+	{
+		vfs_node_t *node = lruTail;
+		while (node && !isEvictable(node))
+			node = node->lruPrev;
+
+		// Everything left is in use
+		if (!node)
+			return;
+
+		removeChild(node->parent, node);
+		freeNode(node);
+	}
+}
+
+// Finds a child of the directory node in memory or loads it via the filesystem driver
+static vfs_node_t *findChild(vfs_node_t *node, const char *name, size_t length)
+{
+	uint32_t hash = hashName(name, length);
+
+	// Check if node is already in memory
+	vfs_node_t *child = lookupChild(node, name, length, hash);
+	if (child)
+	{
+		touchNode(child);
+		return child;
+	}
+
+	// The filesystem driver didn't find it the last time
+	if (lookupMissing(node, name, length, hash))
+		return NULL;
+
+	// The filesystem drivers expect a null terminated name
+	char file[FILENAME_MAX + 1];
+
+	if (length > FILENAME_MAX)
+		return NULL;
+
+	memcpy(file, name, length);
+	file[length] = '\0';
+
 	// Get file via filesystem driver
-	file_desc_t *newFile = node->file_desc->findfile(node->file_desc, file);
+	bool missing = false;
+	file_desc_t *newFile = node->file_desc->findfile(node->file_desc, file, &missing);
 
 	if (!newFile)
 	{
-		kfree(file);
+		// Errors of the driver aren't remembered, the file may exist
+		if (missing)
+			addMissing(node, name, length, hash);
+
 		return NULL;
 	}
 
-	vfs_node_t *newNode = kzalloc(sizeof(vfs_node_t));
-	newNode->file_desc = newFile;
+	vfs_node_t *newNode = allocNode(newFile);
+
+	if (!newNode)
+	{
+		kfree(newFile);
+		return NULL;
+	}
 
 	// Insert node
-	newNode->parent = node;
-	node->child->prev = newNode;
-	newNode->next = node->child;
-	node->child = newNode;
-
-	// Recursively traverse the new node
-	kfree(file);
-	return findfile_helper(newNode, path);
+	if (insertChild(node, newNode))
+	{
+		freeNode(newNode);
+		return NULL;
+	}
+
+	return newNode;
 }
 
-// Recursively finds a file inside the node tree specified by the path
-static vfs_node_t *findfile(vfs_node_t *node, const char *path)
+// Finds a file inside the node tree specified by the first length characters of the path
+// The path is walked in place without copying it
+static vfs_node_t *findfile(vfs_node_t *node, const char *path, size_t length)
 {
-	char *copy = kstrdup(path);
-	vfs_node_t *found = findfile_helper(node, copy);
-	kfree(copy);
-	return found;
+	if (!node) // Path is supposed to start at root dir
+	{
+		// Invalid path (vfs driver only accepts absolute paths)
+		if (length == 0 || path[0] != '/')
+			return NULL;
+
+		node = root;
+	}
+
+	path_iter_t iter;
+	pathIterInit(&iter, path, length);
+
+	const char *name;
+	size_t nameLength;
+
+	while (pathIterNext(&iter, &name, &nameLength))
+	{
+		// Is the (new) node a directory?
+		if (!(node->file_desc->flags & FS_DIRECTORY))
+			return NULL;
+
+		// Check for special characters
+		if (nameLength == 1 && name[0] == '.')
+			continue;
+
+		if (nameLength == 2 && name[0] == '.' && name[1] == '.')
+		{
+			if (node->parent) // The root directory is its own parent
+				node = node->parent;
+			continue;
+		}
+
+		node = findChild(node, name, nameLength);
+
+		if (!node)
+			return NULL;
+	}
+
+	return node;
 }
 
 // Creates a new file at the specified path relative to the node
@@ -203,35 +575,23 @@ static vfs_node_t *createFile(vfs_node_t *node, const char *path, uint32_t flags
 	if (node && !(node->file_desc->flags & FS_DIRECTORY))
 		return NULL;
 
+	size_t length = strlen(path);
+
 	// File already exists
-	if (findfile(node, path))
+	if (findfile(node, path, length))
 		return NULL;
 
-	char *dirPath = getPathDir(path);
-	char *filename = getPathFile(path);
+	size_t nameLength;
+	const char *filename = getPathFile(path, &nameLength);
 
-	if (!filename)
-	{
-		if (dirPath)
-			kfree(dirPath);
+	if (!filename || nameLength > FILENAME_MAX)
 		return NULL;
-	}
 
 	// Find the real parent directory of the new file
-	vfs_node_t *parent = NULL;
-	if (!dirPath)
-		parent = node;
-	else
-		parent = findfile(node, dirPath);
-	
-	if (dirPath)
-		kfree(dirPath);
+	vfs_node_t *parent = filename == path ? node : findfile(node, path, (size_t)(filename - path));
 
-	if (!parent)
-	{
-		kfree(filename);
+	if (!parent || !(parent->file_desc->flags & FS_DIRECTORY))
 		return NULL;
-	}
 
 	// Create the file descriptor
 	file_desc_t *file = kzalloc(sizeof(file_desc_t));
@@ -239,8 +599,7 @@ static vfs_node_t *createFile(vfs_node_t *node, const char *path, uint32_t flags
 	file->mount = parent->file_desc->mount;
 	file->parent = parent->file_desc;
 
-	strcpy(file->name, filename);
-	kfree(filename);
+	memcpy(file->name, filename, nameLength);
 
 	// Create the new file on its filesystem
 	if (parent->file_desc->mkfile(file))
@@ -249,22 +608,344 @@ static vfs_node_t *createFile(vfs_node_t *node, const char *path, uint32_t flags
 		return NULL;
 	}
 
+	forgetMissing(parent, filename, nameLength);
+
 	// Create the vfs node and link it
-	vfs_node_t *newNode = kzalloc(sizeof(vfs_node_t));
-	newNode->file_desc = file;
-	newNode->parent = parent;
+	// (if this fails the file exists on disk and will be found by the next lookup)
+	vfs_node_t *newNode = allocNode(file);
 
-	if (parent->child)
+	if (!newNode)
 	{
-		parent->child->prev = newNode;
-		newNode->next = parent->child;
+		kfree(file);
+		return NULL;
 	}
 
-	parent->child = newNode;
+	if (insertChild(parent, newNode))
+	{
+		freeNode(newNode);
+		return NULL;
+	}
 
 	return newNode;
 }
 
+// Mounts the filesystem at the path, a directory already at the path gets hidden
+static int mountAt(const char *path, mountpoint_t *mount)
+{
+	if (!mount)
+		return EOF;
+
+	size_t nameLength;
+	const char *name = getPathFile(path, &nameLength);
+
+	if (!name || nameLength > FILENAME_MAX)
+		return EOF;
+
+	vfs_node_t *parent = findfile(NULL, path, (size_t)(name - path));
+
+	if (!parent || !(parent->file_desc->flags & FS_DIRECTORY))
+		return EOF;
+
+	// Drop the node of the directory that gets hidden by the mount
+	vfs_node_t *hidden = lookupChild(parent, name, nameLength, hashName(name, nameLength));
+
+	if (hidden)
+	{
+		if (!isEvictable(hidden))
+			return EOF;
+
+		removeChild(parent, hidden);
+		freeNode(hidden);
+	}
+
+	forgetMissing(parent, name, nameLength);
+
+	// The mounted root is pinned, so it is not allocated via allocNode
+	vfs_node_t *node = kzalloc(sizeof(vfs_node_t));
+
+	if (!node)
+		return EOF;
+
+	node->file_desc = mount->root;
+	memcpy(node->file_desc->name, name, nameLength);
+	node->file_desc->name[nameLength] = '\0';
+
+	if (insertChild(parent, node))
+	{
+		kfree(node);
+		return EOF;
+	}
+
+	return 0;
+}
+
+// Files on filesystems in memory don't need the page cache
+static inline bool isCached(file_desc_t *file)
+{
+	return (file->flags & FS_FILE) && file->mount && !(file->mount->flags & MNT_NOCACHE);
+}
+
+// Reads file data through the page cache (character devices are not cached)
+static size_t readFile(file_desc_t *file, size_t offset, size_t size, char *buf)
+{
+	if (isCached(file))
+		return pagecacheRead(file, offset, size, buf);
+
+	return file->read(file, offset, size, buf);
+}
+
+// Writes file data through the page cache (character devices are not cached)
+static size_t writeFile(file_desc_t *file, size_t offset, size_t size, char *buf)
+{
+	file->version = ++lastVersion;
+
+	if (isCached(file))
+		return pagecacheWrite(file, offset, size, buf);
+
+	return file->write(file, offset, size, buf);
+}
+
+// Reads file data into the segments, in one operation if the driver supports it
+static size_t readFileV(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	if (isCached(file))
+		return pagecacheReadv(file, offset, iov, iovcnt);
+
+	if (file->readv)
+		return file->readv(file, offset, iov, iovcnt);
+
+	// One read per segment
+	size_t done = 0;
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		size_t amount = file->read(file, offset + done, iov[i].iov_len, iov[i].iov_base);
+		done += amount;
+
+		if (amount < iov[i].iov_len)
+			break;
+	}
+
+	return done;
+}
+
+// Writes the segments to the file, in one operation if the driver supports it
+static size_t writeFileV(file_desc_t *file, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	file->version = ++lastVersion;
+
+	if (isCached(file))
+		return pagecacheWritev(file, offset, iov, iovcnt);
+
+	if (file->writev)
+		return file->writev(file, offset, iov, iovcnt);
+
+	// One write per segment
+	size_t done = 0;
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		size_t amount = file->write(file, offset + done, iov[i].iov_len, iov[i].iov_base);
+		done += amount;
+
+		if (amount < iov[i].iov_len)
+			break;
+	}
+
+	return done;
+}
+
+// Total length of the segments
+static size_t vectorSize(const struct iovec *iov, int iovcnt)
+{
+	size_t size = 0;
+
+	for (int i = 0; i < iovcnt; i++)
+		size += iov[i].iov_len;
+
+	return size;
+}
+
+// Writes the contents of the write buffer to the file
+// Unwritten contents stay at the beginning of the buffer
+static int writeBuffer(FILE *file)
+{
+	size_t wrSize = (size_t)(file->wrPtr - file->wrBuf);
+
+	if (wrSize == 0)
+		return 0;
+
+	size_t amount = writeFile(file->file_desc, file->pos, wrSize, file->wrBuf);
+	file->pos += amount;
+
+	// Move unwritten contents to beginning of stream-buffer
+	memmove(file->wrBuf, file->wrBuf + amount, wrSize - amount);
+	file->wrPtr = file->wrBuf + (wrSize - amount);
+
+	// The filesystem couldn't write all data
+	if (amount < wrSize)
+	{
+		file->flags |= F_ERROR;
+		return EOF;
+	}
+
+	return 0;
+}
+
+// Seeks keep the read buffer, so the data read ahead has to be dropped
+// for a write to happen at the current position
+static void dropReadAhead(FILE *file)
+{
+	if (file->rdFil == file->rdBuf)
+		return;
+
+	file->pos = file->pos + file->pushback - (size_t)(file->rdFil - file->rdPtr);
+	file->pushback = 0;
+	file->rdPtr = file->rdBuf;
+	file->rdFil = file->rdBuf;
+}
+
+// Size class of a pooled stream buffer, -1 if the size isn't pooled
+static int bufferClass(size_t size)
+{
+	size_t classSize = BUFSIZ;
+
+	for (int i = 0; i < BUFFER_POOL_CLASSES; i++, classSize *= 2)
+	{
+		if (size == classSize)
+			return i;
+	}
+
+	return -1;
+}
+
+// Takes a stream buffer from the pool, falls back to the heap if there is none
+static char *allocStreamBuffer(size_t size)
+{
+	int class = bufferClass(size);
+
+	if (class >= 0 && bufferPoolCount[class] > 0)
+		return bufferPool[class][--bufferPoolCount[class]];
+
+	return kmalloc(size);
+}
+
+// Gives a stream buffer back to the pool, frees it if the pool is full
+static void freeStreamBuffer(char *buf, size_t size)
+{
+	if (!buf)
+		return;
+
+	int class = bufferClass(size);
+
+	if (class >= 0 && bufferPoolCount[class] < BUFFER_POOL_DEPTH)
+		bufferPool[class][bufferPoolCount[class]++] = buf;
+	else
+		kfree(buf);
+}
+
+// Initial buffer size of a stream: one transfer block of the filesystem per half
+static size_t streamBufferSize(file_desc_t *file)
+{
+	size_t size = BUFSIZ;
+
+	// Char devices deliver single chars anyway
+	if (!file->mount || (file->flags & FS_CHRDEVICE))
+		return size;
+
+	while (size < 2 * file->mount->blockSize && size < STREAM_BUFFER_MAX)
+		size *= 2;
+
+	return size;
+}
+
+// Splits the buffer into the read and the write half and resets both
+static void setStreamBuffer(FILE *file, char *buf, size_t size)
+{
+	if (!buf)
+		size = 0;
+
+	file->ioBuf = buf;
+	file->ioEnd = file->ioBuf + size;
+	file->rdBuf = file->ioBuf;
+	file->rdPtr = file->rdBuf;
+	file->rdFil = file->rdBuf;
+	file->rdEnd = file->rdBuf + size / 2;
+	file->wrBuf = file->ioBuf + size / 2;
+	file->wrPtr = file->wrBuf;
+	file->wrEnd = file->ioEnd;
+	file->refills = 0;
+}
+
+// Counts a refill of the stream buffer and doubles its size once the stream
+// turns out to be sequential. Only empty driver-managed buffers get replaced
+static void growStreamBuffer(FILE *file)
+{
+	if (++file->refills < STREAM_GROW_AFTER)
+		return;
+
+	file->refills = 0;
+
+	size_t size = (size_t)(file->ioEnd - file->ioBuf);
+
+	if (!(file->flags & ORIGBUF) || (file->file_desc->flags & FS_CHRDEVICE) || size >= STREAM_BUFFER_MAX)
+		return;
+
+	if (file->rdFil != file->rdBuf || file->wrPtr != file->wrBuf || file->pushback > 0)
+		return;
+
+	// Keep the current buffer if there is no memory for a bigger one
+	char *buf = allocStreamBuffer(size * 2);
+	if (!buf)
+		return;
+
+	freeStreamBuffer(file->ioBuf, size);
+	setStreamBuffer(file, buf, size * 2);
+}
+
+// Opens a stream on the file descriptor
+static FILE *openStream(file_desc_t *desc, const char *mode)
+{
+	// Allocate file
+	FILE *file = kzalloc(sizeof(FILE));
+	if (!file)
+		return NULL;
+
+	file->file_desc = desc;
+
+	// Parse mode
+	file->flags = parseModeString(mode);
+
+	// Cannot open a file in write mode more than once
+	if (desc->openWriteStreams > 0 && (file->flags & (O_RDWR | O_WRONLY)))
+	{
+		kfree(file);
+		return NULL;
+	}
+
+	// Update read/write counts
+	if (file->flags & O_RDWR)
+	{
+		desc->openReadStreams++;
+		desc->openWriteStreams++;
+	}
+	else if (file->flags & O_RDONLY)
+		desc->openReadStreams++;
+	else if (file->flags & O_WRONLY)
+		desc->openWriteStreams++;
+
+	// Initialize buffers (sized to the transfer size of the filesystem)
+	size_t bufSize = streamBufferSize(desc);
+	setStreamBuffer(file, allocStreamBuffer(bufSize), bufSize);
+	file->flags |= ORIGBUF;
+
+	// Go to end in append mode
+	if (file->flags & O_APPEND)
+		vfsSeek(file, 0, SEEK_END);
+
+	return file;
+}
+
 static uint8_t parseModeString(const char *mode)
 {
 	uint8_t flags = 0;
@@ -307,6 +988,9 @@ static uint8_t parseModeString(const char *mode)
 // and mounts it as the root node (path: / )
 int initVFS()
 {
+	// Cached file pages are given back when physical memory runs out
+	pmmSetReclaim(pagecacheReclaim);
+
 	// Find all devices using MBR partitioning
 	initMBR();
 
@@ -371,12 +1055,28 @@ int initVFS()
 		debug_set_color(0x0C, 0x00);
 		debug_print("Could not allocate root vfs node");
 		debug_set_color(0x0F, 0x00);
-		return -1;
+		return -1;
+	}
+
+	// Save the root filesystem inside the root vfs node
+	root->file_desc = mount->root;
+
+	// Scratch files never touch the disk
+	if (mountAt("/tmp", mountTmpfs()))
+	{
+		debug_set_color(0x0C, 0x00);
+		debug_print("Could not mount tmpfs at /tmp");
+		debug_set_color(0x0F, 0x00);
+	}
+
+	// Kernel statistics, generated on read
+	if (mountAt("/proc", mountProcfs()))
+	{
+		debug_set_color(0x0C, 0x00);
+		debug_print("Could not mount procfs at /proc");
+		debug_set_color(0x0F, 0x00);
 	}
 
-	// Save the root filesystem inside the root vfs node
-	root->file_desc = mount->root;
-
 	return 0;
 }
 
@@ -384,8 +1084,11 @@ int initVFS()
 // Tries to create the file if aplicable
 FILE* vfsOpen(const char *path, const char *mode)
 {
+	// Make room for the nodes of the path
+	evictNodes();
+
 	// Check if it the file already exitst
-	vfs_node_t *node = findfile(NULL, path);
+	vfs_node_t *node = findfile(NULL, path, strlen(path));
 
 	if (!node)
 	{
@@ -399,49 +1102,7 @@ FILE* vfsOpen(const char *path, const char *mode)
 			return NULL;
 	}
 
-	// Allocate file
-	FILE *file = kzalloc(sizeof(FILE));
-	file->file_desc = node->file_desc;
-
-	// Parse mode
-	file->flags = parseModeString(mode);
-
-	// Cannot open a file in write mode more than once
-	if (node->file_desc->openWriteStreams > 0 && (file->flags & (O_RDWR | O_WRONLY)))
-	{
-		kfree(file);
-		return NULL;
-	}
-
-	// Update read/write counts
-	if (file->flags & O_RDWR)
-	{
-		node->file_desc->openReadStreams++;
-		node->file_desc->openWriteStreams++;
-	}
-	else if (file->flags & O_RDONLY)
-		node->file_desc->openReadStreams++;
-	else if (file->flags & O_WRONLY)
-		node->file_desc->openWriteStreams++;
-
-	// Initialize buffers
-	char *ioBuf = kmalloc(BUFSIZ);
-	file->ioBuf = ioBuf;
-	file->ioEnd = file->ioBuf + BUFSIZ;
-	file->rdBuf = file->ioBuf;
-	file->rdPtr = file->rdBuf;
-	file->rdFil = file->rdBuf;
-	file->rdEnd = file->rdBuf + BUFSIZ / 2;
-	file->wrBuf = file->ioBuf + BUFSIZ / 2;
-	file->wrPtr = file->wrBuf;
-	file->wrEnd = file->ioEnd;
-	file->flags |= ORIGBUF;
-
-	// Go to end in append mode
-	if (file->flags & O_APPEND)
-		vfsSeek(file, 0, SEEK_END);
-
-	return file;
+	return openStream(node->file_desc, mode);
 }
 
 // Associates the stream with the file at the path
@@ -482,9 +1143,10 @@ FILE *vfsReopen(const char *path, const char *mode, FILE *stream)
 		stream->rdFil = stream->rdBuf;
 		stream->wrPtr = stream->wrBuf;
 		stream->pushback = 0;
+		stream->refills = 0;
 
 		// Free temporary stream
-		kfree(tmp->ioBuf);
+		freeStreamBuffer(tmp->ioBuf, (size_t)(tmp->ioEnd - tmp->ioBuf));
 		kfree(tmp);
 	}
 	else
@@ -537,14 +1199,23 @@ void vfsClose(FILE *file)
 	else if (file->flags & O_WRONLY)
 		file->file_desc->openWriteStreams--;
 
+	// Write the cached data of the file back once the last writer is gone
+	if (file->file_desc->openWriteStreams == 0 && (file->file_desc->flags & FS_FILE))
+		pagecacheSync(file->file_desc);
+
 	// Check if the buffer was allocated by this driver
 	// and free it
 	if (file->flags & ORIGBUF)
-		kfree(file->ioBuf);
+		freeStreamBuffer(file->ioBuf, (size_t)(file->ioEnd - file->ioBuf));
 
-	cleanupTree(); // Cleanup node tree
+	evictNodes(); // Keep the node tree within its budget
 
+	// Files outside the node tree (pipes) free themselves
+	file_desc_t *desc = file->file_desc;
 	kfree(file); // Free used memory
+
+	if (desc->close && desc->openReadStreams == 0 && desc->openWriteStreams == 0)
+		desc->close(desc);
 	return;
 }
 
@@ -562,7 +1233,7 @@ size_t vfsRead(FILE *file, void *buf, size_t size)
 	if (file->mode == _IONBF || file->ioBuf == NULL) // No buffer available
 	{
 		// Read directly into the passed buffer
-		size_t amount =  file->file_desc->read(file->file_desc, file->pos, size, buffer);
+		size_t amount =  readFile(file->file_desc, file->pos, size, buffer);
 		
 		if (amount < size)
 			file->flags |= O_EOF;
@@ -582,8 +1253,13 @@ size_t vfsRead(FILE *file, void *buf, size_t size)
 	while(!(file->flags & O_EOF && file->rdPtr == file->rdFil) && read < size)
 	{
 		// Empty the buffer
-		for (; file->rdPtr < file->rdFil && read < size; file->rdPtr++, read++)
-			buffer[read] = *file->rdPtr;
+		size_t buffered = (size_t)(file->rdFil - file->rdPtr);
+		if (buffered > size - read)
+			buffered = size - read;
+
+		memcpy(buffer + read, file->rdPtr, buffered);
+		file->rdPtr += buffered;
+		read += buffered;
 
 		// Revert changes to file position if pushback was used
 		file->pos += file->pushback;
@@ -593,17 +1269,51 @@ size_t vfsRead(FILE *file, void *buf, size_t size)
 		if (file->flags & O_EOF || read >= size)
 			break;
 
+		// Requests larger than the stream buffer go straight to the driver
+		if (size - read >= rdSize && !(file->file_desc->flags & FS_CHRDEVICE))
+		{
+			file->rdPtr = file->rdBuf;
+			file->rdFil = file->rdBuf;
+
+			size_t amount = readFile(file->file_desc, file->pos, size - read, buffer + read);
+			file->pos += amount;
+
+			if (amount < size - read)
+				file->flags |= O_EOF;
+
+			read += amount;
+			break;
+		}
+
 		// Read next portion into buffer
 		file->rdPtr = file->rdBuf;
 		file->rdFil = file->rdBuf;
 
-		size_t amount = file->file_desc->read(file->file_desc, file->pos, rdSize, file->rdBuf);
-		file->pos += amount;
-		file->rdFil += amount;
+		// Sequential streams get bigger buffers
+		growStreamBuffer(file);
+		if (!(file->file_desc->flags & FS_CHRDEVICE))
+			rdSize = (size_t)(file->rdEnd - file->rdBuf);
+
+		// Files are read in windows aligned to the buffer size. After a seek the buffer
+		// also holds the data in front of the position, so seeking around inside the
+		// window doesn't hit the driver again. Sequential reads stay aligned
+		size_t skip = 0;
+		if (!(file->file_desc->flags & FS_CHRDEVICE))
+			skip = file->pos % rdSize;
+
+		size_t amount = readFile(file->file_desc, file->pos - skip, rdSize, file->rdBuf);
 
 		// EOF reached
 		if (amount < rdSize)
 			file->flags |= O_EOF;
+
+		// Nothing behind the position
+		if (amount <= skip)
+			continue;
+
+		file->pos += amount - skip;
+		file->rdPtr += skip;
+		file->rdFil += amount;
 	}
 
 	// Return the amount of bytes written
@@ -621,10 +1331,12 @@ size_t vfsWrite(FILE *file, const void *buf, size_t size)
 	if (!buffer)
 		return 0;
 
+	dropReadAhead(file);
+
 	if (file->mode == _IONBF || file->ioBuf == NULL) // No buffer available
 	{
 		// Read directly into the passed buffer
-		size_t amount = file->file_desc->write(file->file_desc, file->pos, size, buffer);
+		size_t amount = writeFile(file->file_desc, file->pos, size, buffer);
 
 		if (amount < size)
 			file->flags |= F_ERROR;
@@ -633,65 +1345,334 @@ size_t vfsWrite(FILE *file, const void *buf, size_t size)
 	}
 
 	size_t written = 0;
-	size_t wrSize = 0;
-	bool forceFlush = false;
+	size_t wrSize = (size_t)(file->wrEnd - file->wrBuf);
 
 	// Write until user-buffer is empty
 	while(written < size)
 	{
-		// Fill the stream-buffer
-		for (; file->wrPtr < file->wrEnd && written < size; file->wrPtr++, written++)
+		size_t remaining = size - written;
+
+		// Requests larger than the stream buffer go straight to the driver
+		// after the buffered contents
+		if (remaining >= wrSize)
+		{
+			if (writeBuffer(file))
+				break;
+
+			size_t amount = writeFile(file->file_desc, file->pos, remaining, buffer + written);
+			file->pos += amount;
+			written += amount;
+
+			if (amount < remaining)
+				file->flags |= F_ERROR;
+
+			break;
+		}
+
+		size_t amount = (size_t)(file->wrEnd - file->wrPtr);
+		if (amount > remaining)
+			amount = remaining;
+
+		// Flush contents on newline if line buffered stream
+		bool lineEnd = false;
+		if (file->mode == _IOLBF)
 		{
-			*file->wrPtr = buffer[written];
+			char *newline = memchr(buffer + written, '\n', amount);
 
-			// Flush contents on newline if line buffered stream
-			if (file->mode == _IOLBF && buffer[written] == '\n')
+			if (newline)
 			{
-				written++;
-				file->wrPtr++;
-				forceFlush = true; // Prevent premature break if written == size
+				amount = (size_t)(newline - (buffer + written)) + 1;
+				lineEnd = true;
+			}
+		}
+
+		// Fill the stream-buffer
+		memcpy(file->wrPtr, buffer + written, amount);
+		file->wrPtr += amount;
+		written += amount;
+
+		// Write the buffer to the file once it is full or a line is complete
+		if (lineEnd || file->wrPtr == file->wrEnd)
+		{
+			if (writeBuffer(file))
 				break;
+
+			// Sequential streams get bigger buffers
+			if (!lineEnd)
+			{
+				growStreamBuffer(file);
+				wrSize = (size_t)(file->wrEnd - file->wrBuf);
 			}
 		}
+	}
 
-		// Is the user-buffer empty?
-		if (!forceFlush && written >= size)
-			break;
+	// Return the number of bytes written
+	return written;
+}
+
+// Reads into the segments one after another
+// Requests larger than the read buffer go to the driver as one operation
+size_t vfsReadv(FILE *file, const struct iovec *iov, int iovcnt)
+{
+	// Was the file opened in read mode?
+	if (!(file->flags & O_RDONLY || file->flags & O_RDWR))
+		return 0;
 
-		wrSize = (size_t)(file->wrPtr - file->wrBuf);
+	if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
+		return 0;
 
-		// Write the full buffer to the file
-		size_t amount = file->file_desc->write(file->file_desc, file->pos, wrSize, file->wrBuf);
-		file->pos += amount;
-		file->wrPtr = file->wrBuf + (wrSize - amount);
+	size_t size = vectorSize(iov, iovcnt);
+	bool buffered = file->mode != _IONBF && file->ioBuf != NULL;
 
-		// Move unwritten contents to beginning of stream-buffer
-		memcpy(file->wrBuf, file->wrBuf + amount, wrSize - amount);
+	// Small requests, buffered data and char devices take the path of vfsRead
+	if ((buffered && size < (size_t)(file->rdEnd - file->rdBuf)) || file->rdPtr != file->rdFil ||
+		file->pushback > 0 || (file->file_desc->flags & FS_CHRDEVICE))
+	{
+		size_t read = 0;
 
-		// Break if the filesystem couldn't write all data
-		if (amount < wrSize)
+		for (int i = 0; i < iovcnt; i++)
 		{
-			file->flags |= F_ERROR;
+			size_t amount = vfsRead(file, iov[i].iov_base, iov[i].iov_len);
+			read += amount;
+
+			if (amount < iov[i].iov_len)
+				break;
+		}
+
+		return read;
+	}
+
+	file->rdPtr = file->rdBuf;
+	file->rdFil = file->rdBuf;
+
+	size_t amount = readFileV(file->file_desc, file->pos, iov, iovcnt);
+	file->pos += amount;
+
+	if (amount < size)
+		file->flags |= O_EOF;
+
+	return amount;
+}
+
+// Writes the segments one after another
+// Segments that don't fit into the write buffer go to the driver as one operation
+size_t vfsWritev(FILE *file, const struct iovec *iov, int iovcnt)
+{
+	// Was the file opened in write mode?
+	if (!(file->flags & O_WRONLY || file->flags & O_RDWR))
+		return 0;
+
+	if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
+		return 0;
+
+	size_t size = vectorSize(iov, iovcnt);
+	bool buffered = file->mode != _IONBF && file->ioBuf != NULL;
+
+	// Fill the stream buffer if everything fits
+	if (buffered && size < (size_t)(file->wrEnd - file->wrPtr))
+	{
+		size_t written = 0;
+
+		for (int i = 0; i < iovcnt; i++)
+		{
+			size_t amount = vfsWrite(file, iov[i].iov_base, iov[i].iov_len);
+			written += amount;
+
+			if (amount < iov[i].iov_len)
+				break;
+		}
+
+		return written;
+	}
+
+	// Write the buffered contents first to keep the order
+	dropReadAhead(file);
+	if (writeBuffer(file))
+		return 0;
+
+	size_t amount = writeFileV(file->file_desc, file->pos, iov, iovcnt);
+	file->pos += amount;
+
+	if (amount < size)
+		file->flags |= F_ERROR;
+
+	return amount;
+}
+
+// Copies up to len bytes from the current position of in to the current position of out
+// Between two files the data is moved by the drivers in chunks aligned to the clusters
+// of the destination, which gets preallocated in one piece beforehand
+size_t vfsCopyRange(FILE *in, FILE *out, size_t len)
+{
+	// Were the files opened in the right modes?
+	if (!(in->flags & O_RDONLY || in->flags & O_RDWR) || !(out->flags & O_WRONLY || out->flags & O_RDWR))
+		return 0;
+
+	size_t copied = 0;
+
+	// Data already in the read buffer goes first
+	size_t buffered = (size_t)(in->rdFil - in->rdPtr);
+	if (buffered > len)
+		buffered = len;
+
+	if (buffered > 0)
+	{
+		copied = vfsWrite(out, in->rdPtr, buffered);
+		in->rdPtr += copied;
+	}
+
+	if (copied == len || copied < buffered)
+		return copied;
+
+	// Revert changes to file position if pushback was used
+	in->pos += in->pushback;
+	in->pushback = 0;
+
+	// The read buffer is empty now, so the position of in is the file position
+	in->rdPtr = in->rdBuf;
+	in->rdFil = in->rdBuf;
+
+	// Write the buffered contents first to keep the order
+	dropReadAhead(out);
+	if (writeBuffer(out))
+		return copied;
+
+	char *chunk = allocStreamBuffer(STREAM_BUFFER_MAX);
+	if (!chunk)
+		return copied;
+
+	file_desc_t *src = in->file_desc;
+	file_desc_t *dst = out->file_desc;
+
+	// Devices and copies inside one file take the path of vfsRead and vfsWrite
+	if (!(src->flags & FS_FILE) || !(dst->flags & FS_FILE) || src == dst)
+	{
+		while (copied < len)
+		{
+			size_t amount = len - copied;
+			if (amount > STREAM_BUFFER_MAX)
+				amount = STREAM_BUFFER_MAX;
+
+			size_t read = vfsRead(in, chunk, amount);
+			size_t written = vfsWrite(out, chunk, read);
+			copied += written;
+
+			if (written < read || read < amount)
+				break;
+		}
+
+		freeStreamBuffer(chunk, STREAM_BUFFER_MAX);
+		return copied;
+	}
+
+	// The drivers get accessed directly, so the page cache has to match the disk
+	pagecacheSync(src);
+	pagecacheSync(dst);
+
+	size_t remaining = len - copied;
+	if (in->pos >= src->length)
+		remaining = 0;
+	else if (remaining > src->length - in->pos)
+		remaining = src->length - in->pos;
+
+	if (remaining < len - copied)
+		in->flags |= O_EOF;
+
+	// Allocate the destination in one piece
+	if (dst->reserve && out->pos + remaining > dst->length)
+		dst->reserve(dst, out->pos + remaining);
+
+	while (remaining > 0)
+	{
+		// Chunks stay aligned to the destination, so every cluster gets written once.
+		// Cluster sizes are powers of two, so the chunk size is a multiple or a divisor of them
+		size_t amount = STREAM_BUFFER_MAX - out->pos % STREAM_BUFFER_MAX;
+		if (amount > remaining)
+			amount = remaining;
+
+		size_t read = src->read(src, in->pos, amount, chunk);
+		size_t written = dst->write(dst, out->pos, read, chunk);
+
+		in->pos += written;
+		out->pos += written;
+		copied += written;
+		remaining -= written;
+
+		if (written < read)
+		{
+			out->flags |= F_ERROR;
+			break;
+		}
+
+		if (read < amount)
+		{
+			in->flags |= O_EOF;
 			break;
 		}
 	}
 
-	// Return the number of bytes written
-	return written;
+	// Release the clusters reserved for the part that couldn't be copied
+	if (dst->reserve && remaining > 0)
+		dst->reserve(dst, dst->length);
+
+	// Cached pages of the destination are outdated now
+	pagecacheInvalidate(dst);
+	dst->version = ++lastVersion;
+
+	freeStreamBuffer(chunk, STREAM_BUFFER_MAX);
+
+	return copied;
+}
+
+// Creates a pipe and opens a stream on each of its ends
+int vfsPipe(FILE **readEnd, FILE **writeEnd)
+{
+	file_desc_t *pipe = pipeCreate();
+	if (!pipe)
+		return EOF;
+
+	// The pipe frees itself when both ends are closed
+	FILE *in = openStream(pipe, "r");
+	FILE *out = openStream(pipe, "w");
+
+	if (!in || !out)
+	{
+		// Closing the end that got opened frees the pipe too
+		if (in || out)
+			vfsClose(in ? in : out);
+		else
+			pipe->close(pipe);
+
+		return EOF;
+	}
+
+	*readEnd = in;
+	*writeEnd = out;
+
+	return 0;
+}
+
+// Returns the position the next read or write of the stream would happen at
+size_t vfsTell(FILE *file)
+{
+	return file->pos + file->pushback - (size_t)(file->rdFil - file->rdPtr) + (size_t)(file->wrPtr - file->wrBuf);
 }
 
 // Sets the file stream position to an offset from the specified origin
 int vfsSeek(FILE *file, long offset, int origin)
 {
 	size_t pos = 0;
+	size_t current = vfsTell(file);
 
 	// First flush unwritten data
-	vfsFlush(file);
+	// This also drops the read buffer as pushed back chars may differ from the file
+	if (file->wrPtr != file->wrBuf || file->pushback > 0)
+		vfsFlush(file);
 	
 	switch(origin)
 	{
 		case SEEK_CUR: // Origin = current position
-			pos = file->pos;
+			pos = current;
 			break;
 		case SEEK_END: // Origin = EOF
 			pos = file->file_desc->length;
@@ -706,7 +1687,23 @@ int vfsSeek(FILE *file, long offset, int origin)
 
 	pos += offset;
 
+	// Keep the read buffer if the new position lies inside it
+	size_t bufStart = file->pos - (size_t)(file->rdFil - file->rdBuf);
+
+	if (pos >= bufStart && pos <= file->pos)
+	{
+		file->rdPtr = file->rdBuf + (pos - bufStart);
+
+		if (pos < file->file_desc->length)
+			file->flags &= ~O_EOF;
+
+		return 0;
+	}
+
+	file->rdPtr = file->rdBuf;
+	file->rdFil = file->rdBuf;
 	file->pos = pos;
+	file->refills = 0; // Not sequential anymore
 
 	// Reset EOF if we don't exceed the filesize
 	if(pos < file->file_desc->length)
@@ -728,29 +1725,15 @@ int vfsFlush(FILE *file)
 	if (!(file->flags & O_WRONLY || file->flags & O_RDWR))
 		return EOF;
 
-	// Determine amount to be written
-	size_t wrSize = (size_t)(file->wrPtr - file->wrBuf);
-
 	// Write to the drive
-	size_t amount = file->file_desc->write(file->file_desc, file->pos, wrSize, file->wrBuf);
-	file->pos += amount;
-	file->wrPtr = file->wrBuf + (wrSize - amount);
-
-	// Move unwritten contents to beginning
-	memcpy(file->wrBuf, file->wrBuf + amount, wrSize - amount);
+	size_t pos = file->pos;
+	int ret = writeBuffer(file);
 
 	// Clear EOF if something was written
-	if (amount > 0)
+	if (file->pos != pos)
 		file->flags &= ~O_EOF;
 
-	// Check if write error occured
-	if (amount < wrSize)
-	{
-		file->flags |= F_ERROR;
-		return EOF;
-	}
-
-	return 0;
+	return ret;
 }
 
 // Sets the internal buffer to the specified parameters
@@ -762,28 +1745,22 @@ int vfsSetvbuf(FILE *file, char *buf, int mode, size_t size)
 	char *ioBuf = NULL;
 
 	if (!buf) // Use driver-managed buffer
-		ioBuf = size > 0 ? kmalloc(size) : NULL;
+		ioBuf = size > 0 ? allocStreamBuffer(size) : NULL;
 	else      // Use user-buffer
 		ioBuf = buf;
 
 	// Free old buffer if driver-managed
 	if (file->flags & ORIGBUF)
-		kfree(file->ioBuf);
+		freeStreamBuffer(file->ioBuf, (size_t)(file->ioEnd - file->ioBuf));
 
 	// Set stream buffer properties
-	file->ioBuf = ioBuf;
-	file->ioEnd = file->ioBuf + size;
-	file->rdBuf = file->ioBuf;
-	file->rdPtr = file->rdBuf;
-	file->rdFil = file->rdBuf;
-	file->rdEnd = file->rdBuf + size / 2;
-	file->wrBuf = file->ioBuf + size / 2;
-	file->wrPtr = file->wrBuf;
-	file->wrEnd = file->ioEnd;
+	setStreamBuffer(file, ioBuf, size);
 
 	// Clear ORIGBUF if the buffer is user-allocated
 	if (buf)
 		file->flags &= ~ORIGBUF;
+	else
+		file->flags |= ORIGBUF;
 
 	file->mode = mode;
 
@@ -794,75 +1771,69 @@ int vfsSetvbuf(FILE *file, char *buf, int mode, size_t size)
 int vfsRename(const char *oldPath, const char *newPath)
 {
 	// Find file at oldPath
-	vfs_node_t *node = findfile(NULL, oldPath);
+	vfs_node_t *node = findfile(NULL, oldPath, strlen(oldPath));
 
-	if (!node)
+	// Roots of filesystems can't be moved
+	if (!node || isMountRoot(node))
 		return EOF;
 
+	size_t newLength = strlen(newPath);
+
 	// File at newPath already exists
-	if (findfile(NULL, newPath))
+	if (findfile(NULL, newPath, newLength))
 		return EOF;
 
-	// Get directory of newPath
-	char *newDir = getPathDir(newPath);
+	// Get file and directory of newPath
+	size_t nameLength;
+	const char *newName = getPathFile(newPath, &nameLength);
 
-	if (!newDir)
+	if (!newName || nameLength > FILENAME_MAX)
 		return EOF;
 
 	// Find parent directory
-	vfs_node_t *newParent = findfile(NULL, newDir);
-
-	kfree(newDir);
+	vfs_node_t *newParent = findfile(NULL, newPath, (size_t)(newName - newPath));
 
 	// Parent directory not found
 	if (!newParent)
-	{
-		kfree(newDir);
 		return EOF;
-	}
 
 	// Parent file is not a directory
 	if (!(newParent->file_desc->flags & FS_DIRECTORY))
-	{
-		kfree(newDir);
 		return EOF;
-	}
+
+	// Files can't be moved to another filesystem
+	if (newParent->file_desc->mount != node->file_desc->mount)
+		return EOF;
 
 	// Change name of file at oldPath
-	char *oldName = getPathFile(oldPath);
-	char *newName = getPathFile(newPath);
+	char oldName[FILENAME_MAX + 1];
+	strcpy(oldName, node->file_desc->name);
 
-	strcpy(node->file_desc->name, newName);
+	memcpy(node->file_desc->name, newName, nameLength);
+	node->file_desc->name[nameLength] = '\0';
 
 	// Rename file in the filesystem
 	if (node->file_desc->rename(node->file_desc, newParent->file_desc, oldName))
 	{
 		strcpy(node->file_desc->name, oldName);
-		kfree(oldName);
-		kfree(newName);
 		return EOF;
 	}
-	
-	kfree(oldName);
-	kfree(newName);
 
-	// Unlink file at previous node
-	if (node->parent->child == node)
-		node->parent->child = node->next;
+	forgetMissing(newParent, newName, nameLength);
 
-	if (node->next)
-		node->next->prev = node->prev;
-
-	if (node->prev)
-		node->prev->next = node->next;
+	// Unlink file at previous node (still hashed under the old name)
+	removeChild(node->parent, node);
 
 	// Link file at new node
-	node->parent = newParent;
-	newParent->child->prev = node;
-	node->next = newParent->child;
-	newParent->child = node;
 	node->file_desc->parent = newParent->file_desc;
 
+	if (insertChild(newParent, node))
+	{
+		// Drop the node, the file will be found again by the next lookup
+		if (node->file_desc->openReadStreams == 0 && node->file_desc->openWriteStreams == 0)
+			freeNode(node);
+	}
+
 	return 0;
 }
 
@@ -870,52 +1841,49 @@ int vfsRename(const char *oldPath, const char *newPath)
 int vfsRemove(const char *path)
 {
 	// Find the file
-	vfs_node_t *file = findfile(NULL, path);
+	vfs_node_t *file = findfile(NULL, path, strlen(path));
 
 	if (!file)
 		return EOF;
 
+	// Roots of filesystems can't be removed
+	if (isMountRoot(file))
+		return EOF;
+
 	if (file->file_desc->openReadStreams > 0 || file->file_desc->openWriteStreams > 0)
 		return EOF;
 
 	// Check if directory is empty
 	if (file->file_desc->flags & FS_DIRECTORY)
 	{
-		// Try to read a directory entry
-		DIR *dir = vfsOpendir(path);
+		// Read the entries directly, closing a directory stream would clean up the node
+		DIR dir;
+		memset(&dir, 0, sizeof(DIR));
+		dir.dirfile = file->file_desc;
+
 		dirent *entry = NULL;
 
-		while((entry = vfsReaddir(dir)))
+		while((entry = vfsReaddir(&dir)))
 		{
 			// The entry is neither . nor .. -> Directory is not empty
 			if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
-			{
-				vfsClosedir(dir);
 				return EOF;
-			}
 		}
-
-		vfsClosedir(dir);
 	}
 
 	// Remove the file from the filesystem
 	if(file->parent->file_desc->rmfile(file->file_desc))
 		return EOF;
 
-	// Unlink file
-	if (file->parent->child == file)
-		file->parent->child = file->next;
-
-	if (file->next)
-		file->next->prev = file->prev;
+	// Its inode may be reused by the next file
+	if (file->file_desc->flags & FS_FILE)
+		pagecacheInvalidate(file->file_desc);
 
-	if (file->prev)
-		file->prev->next = file->next;
-
-	kfree(file->file_desc);
-	kfree(file);
+	// Unlink file
+	removeChild(file->parent, file);
+	freeNode(file);
 
-	cleanupTree();
+	evictNodes();
 
 	return 0;
 }
@@ -1035,23 +2003,18 @@ int vfsUngetc(int ch, FILE *stream)
 DIR *vfsOpendir(const char *path)
 {
 	// Find the directory inside the node tree
-	DIR *dir = kzalloc(sizeof(DIR));
-	vfs_node_t *node = findfile(NULL, path);
+	vfs_node_t *node = findfile(NULL, path, strlen(path));
 
-	if (!node)
-	{
-		kfree(dir);
+	// Check if the file pointed to by the path is a directory
+	if (!node || !(node->file_desc->flags & FS_DIRECTORY))
 		return NULL;
-	}
-	
-	dir->dirfile = node->file_desc;
 
-	// Check if the file pointed to by the path is a directory
-	if (!(dir->dirfile->flags & FS_DIRECTORY))
-	{
-		kfree(dir);
+	DIR *dir = kzalloc(sizeof(DIR));
+
+	if (!dir)
 		return NULL;
-	}
+
+	dir->dirfile = node->file_desc;
 
 	// Increase the number of open read streams
 	dir->dirfile->openReadStreams++;
@@ -1066,7 +2029,7 @@ int vfsClosedir(DIR *dir)
 	dir->dirfile->openReadStreams--;
 	kfree(dir);
 
-	cleanupTree();
+	evictNodes();
 
 	return 0;
 }
@@ -1088,3 +2051,13 @@ dirent *vfsReaddir(DIR *dir)
 	// Return the dir entry
 	return &dir->entry;
 }
+
+void vfsGetStats(vfs_stats_t *stats)
+{
+	stats->nodes = nodeCount;
+	stats->nodeBudget = VFS_NODE_BUDGET;
+	stats->pooledBuffers = 0;
+
+	for (int i = 0; i < BUFFER_POOL_CLASSES; i++)
+		stats->pooledBuffers += bufferPoolCount[i];
+}
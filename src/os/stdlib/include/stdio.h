@@ -44,6 +44,9 @@ int setvbuf(FILE *stream, char *buffer, int mode, size_t size);
 
 size_t fread(void *buffer, size_t size, size_t count, FILE *stream);
 size_t fwrite(const void *buffer, size_t size, size_t count, FILE *stream);
+size_t readv(FILE *stream, const struct iovec *iov, int iovcnt);
+size_t writev(FILE *stream, const struct iovec *iov, int iovcnt);
+size_t copy_file_range(FILE *in, FILE *out, size_t len);
 
 int fgetc(FILE *stream);
 int getc(FILE *stream);
@@ -1335,6 +1335,54 @@ size_t fwrite(const void *buffer, size_t size, size_t count, FILE *stream)
 	return written / size;
 }
 
+// Reads into multiple buffers with as few filesystem operations as possible
+size_t readv(FILE *stream, const struct iovec *iov, int iovcnt)
+{
+	if (!stream)
+	{
+		errno = EBADF;
+		return 0;
+	}
+
+	if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	return vfsReadv(stream, iov, iovcnt);
+}
+
+// Writes multiple buffers with as few filesystem operations as possible
+size_t writev(FILE *stream, const struct iovec *iov, int iovcnt)
+{
+	if (!stream)
+	{
+		errno = EBADF;
+		return 0;
+	}
+
+	if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
+	{
+		errno = EINVAL;
+		return 0;
+	}
+
+	return vfsWritev(stream, iov, iovcnt);
+}
+
+// Copies between two streams without passing the data through a user buffer
+size_t copy_file_range(FILE *in, FILE *out, size_t len)
+{
+	if (!in || !out)
+	{
+		errno = EBADF;
+		return 0;
+	}
+
+	return vfsCopyRange(in, out, len);
+}
+
 int fgetc(FILE *stream)
 {
 	if (!stream)
@@ -1652,10 +1700,12 @@ long ftell(FILE *stream)
 		return EOF;
 	}
 
-	if (stream->pos > LONG_MAX)
+	size_t pos = vfsTell(stream);
+
+	if (pos > LONG_MAX)
 		errno = EOVERFLOW;
 
-	return stream->pos;
+	return pos;
 }
 
 int fgetpos(FILE *stream, fpos_t *pos)
@@ -1666,7 +1716,7 @@ int fgetpos(FILE *stream, fpos_t *pos)
 		return EOF;
 	}
 
-	*pos = stream->pos;
+	*pos = vfsTell(stream);
 
 	return 0;
 }
@@ -1679,6 +1729,12 @@ int fseek(FILE *stream, long offset, int origin)
 		return EOF;
 	}
 
+	if (!stream)
+	{
+		errno = EBADF;
+		return EOF;
+	}
+
 	if (offset < 0)
 	{
 		if (origin == SEEK_SET)
@@ -1686,17 +1742,16 @@ int fseek(FILE *stream, long offset, int origin)
 			errno = EINVAL;
 			return EOF;
 		}
-		else if (stream->pos < (unsigned long)-offset)
+		else if (origin == SEEK_CUR && vfsTell(stream) < (unsigned long)-offset)
+		{
+			errno = EINVAL;
+			return EOF;
+		}
+		else if (origin == SEEK_END && stream->file_desc->length < (unsigned long)-offset)
 		{
 			errno = EINVAL;
 			return EOF;
 		}
-	}
-
-	if (!stream)
-	{
-		errno = EBADF;
-		return EOF;
 	}
 
 	return vfsSeek(stream, offset, origin);
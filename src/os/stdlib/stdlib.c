@@ -4,6 +4,8 @@
 #include "mt19937.h"
 //Kernel includes
 #include "../../include/memory/heap.h"
+#include "../../include/memory/arena.h"
+#include <string.h>
 
 char* ulltoa(unsigned long long num, char* buf, size_t base, bool prepend_zeros)
 {
@@ -196,20 +198,33 @@ int atoi(const char *str)
 }
 
 //Heap functions
+//Programs allocate from their own arena which is released as a whole when they exit.
+//Pointers handed out by the kernel (e.g. resolve_path) still live on the kernel heap.
 void* malloc(size_t size)
 {
+	if(currentArena)
+		return arenaAlloc(currentArena, size);
 	return kmalloc(size);
 }
 void free(void *ptr)
 {
-	return kfree(ptr);
+	if(!currentArena || arenaFree(currentArena, ptr))
+		kfree(ptr);
 }
 void* calloc(size_t nmemb, size_t size)
 {
-	return kcalloc(nmemb, size);
+	if(!currentArena)
+		return kcalloc(nmemb, size);
+
+	void* alloc = arenaAlloc(currentArena, nmemb * size);
+	if(alloc)
+		memset(alloc, 0, nmemb * size);
+	return alloc;
 }
 void* realloc(void *ptr, size_t size)
 {
+	if(currentArena && (!ptr || arenaOwns(currentArena, ptr)))
+		return arenaRealloc(currentArena, ptr, size);
 	return krealloc(ptr, size);
 }
 
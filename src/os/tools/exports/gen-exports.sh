@@ -0,0 +1,38 @@
+#!/bin/sh
+# Generates the export table of the kernel from its relocatable image.
+# ld-owos resolves the symbols of libkernel.so with it, so the library never has to be read at runtime.
+# The table is sorted by name in byte order (like strcmp) to be binary searched.
+#
+# Usage: gen-exports.sh <kernel-r.elf> > kernel_exports.S
+# NM selects the nm of the cross toolchain
+
+NM=${NM:-nm}
+
+if [ $# -ne 1 ]; then
+	echo "Usage: $0 <kernel-r.elf>" >&2
+	exit 1
+fi
+
+# Global functions and variables defined inside the kernel
+SYMBOLS=$(${NM} -g --defined-only "$1" | awk '$2 ~ /^[TDBRC]$/ && $3 !~ /\./ { print $3 }' | LC_ALL=C sort -u) || exit 1
+
+echo "# Generated by gen-exports.sh, do not edit"
+echo "	.section .rodata"
+echo "	.align 4"
+echo "	.global kernel_export_count"
+echo "kernel_export_count:"
+echo "	.long $(echo "${SYMBOLS}" | grep -c .)"
+echo "	.global kernel_exports"
+echo "kernel_exports:"
+
+i=0
+for symbol in ${SYMBOLS}; do
+	echo "	.long .Lname${i}, ${symbol}"
+	i=$((i + 1))
+done
+
+i=0
+for symbol in ${SYMBOLS}; do
+	echo ".Lname${i}: .asciz \"${symbol}\""
+	i=$((i + 1))
+done
@@ -0,0 +1,433 @@
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <memory/heap.h>
+#include <memory/pmm.h>
+#include <debug.h>
+
+#include "mock.h"
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define SAMPLE_INTERVAL 1024    // Operations between two fragmentation samples
+#define MAX_LIVE        4096    // Slots of the synthetic workloads
+#define TRACE_SLOTS     (1 << 18) // Size of the pointer translation table for traces
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// Measurements of one workload
+typedef struct result_t
+{
+	size_t ops;
+	uint64_t nanoseconds;
+	uint32_t fragmentationMax;
+	uint32_t fragmentationEnd;
+} result_t;
+
+typedef void (*workload_t)(result_t *result);
+
+// Maps a pointer of the recorded session to the replayed allocation
+typedef struct trace_slot_t
+{
+	uint32_t key;
+	void *value;
+} trace_slot_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+static struct timespec batchStart;
+
+static void *slots[MAX_LIVE];
+
+static trace_slot_t traceSlots[TRACE_SLOTS];
+static const char *tracePath = NULL;
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+// xorshift64 for reproducible workloads
+static uint32_t rng()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 7;
+	rngState ^= rngState << 17;
+	return (uint32_t)rngState;
+}
+
+// Size between min and max with more small sizes than big ones
+static size_t logSize(size_t min, size_t max)
+{
+	size_t size = max;
+	while (size > min && rng() % 2)
+		size /= 2;
+
+	return size > min ? min + rng() % (size - min + 1) : min;
+}
+
+static void startBatch()
+{
+	clock_gettime(CLOCK_MONOTONIC, &batchStart);
+}
+
+// Adds the time since startBatch() and samples the fragmentation outside of the timing
+static void endBatch(result_t *result, size_t ops)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	result->nanoseconds += (uint64_t)(end.tv_sec - batchStart.tv_sec) * 1000000000ULL + end.tv_nsec - batchStart.tv_nsec;
+	result->ops += ops;
+
+	heap_stats_t stats;
+	heapGetStats(&stats);
+
+	if (stats.fragmentation > result->fragmentationMax)
+		result->fragmentationMax = stats.fragmentation;
+	result->fragmentationEnd = stats.fragmentation;
+}
+
+// Frees every slot still in use
+static void freeSlots(result_t *result)
+{
+	startBatch();
+	size_t ops = 0;
+
+	for (size_t i = 0; i < MAX_LIVE; i++)
+	{
+		if (slots[i])
+		{
+			kfree(slots[i]);
+			slots[i] = NULL;
+			ops++;
+		}
+	}
+
+	endBatch(result, ops);
+}
+
+// Many small allocations freed in allocation order
+static void workloadFifo(result_t *result)
+{
+	for (int round = 0; round < 8; round++)
+	{
+		startBatch();
+		for (size_t i = 0; i < MAX_LIVE; i++)
+			slots[i] = kmalloc(16 + rng() % 112);
+		endBatch(result, MAX_LIVE);
+
+		startBatch();
+		for (size_t i = 0; i < MAX_LIVE; i++)
+		{
+			kfree(slots[i]);
+			slots[i] = NULL;
+		}
+		endBatch(result, MAX_LIVE);
+	}
+}
+
+// Many small allocations freed in reverse order
+static void workloadLifo(result_t *result)
+{
+	for (int round = 0; round < 8; round++)
+	{
+		startBatch();
+		for (size_t i = 0; i < MAX_LIVE; i++)
+			slots[i] = kmalloc(16 + rng() % 112);
+		endBatch(result, MAX_LIVE);
+
+		startBatch();
+		for (size_t i = MAX_LIVE; i-- > 0;)
+		{
+			kfree(slots[i]);
+			slots[i] = NULL;
+		}
+		endBatch(result, MAX_LIVE);
+	}
+}
+
+// Random allocations and frees with sizes up to 16KiB
+static void workloadRandom(result_t *result)
+{
+	for (int batch = 0; batch < 100; batch++)
+	{
+		startBatch();
+		for (int i = 0; i < SAMPLE_INTERVAL; i++)
+		{
+			size_t slot = rng() % MAX_LIVE;
+
+			if (slots[slot])
+			{
+				kfree(slots[slot]);
+				slots[slot] = NULL;
+			}
+			else
+				slots[slot] = kmalloc(logSize(8, 16384));
+		}
+		endBatch(result, SAMPLE_INTERVAL);
+	}
+
+	freeSlots(result);
+}
+
+// Growth pattern of the editor: a row array growing by one entry,
+// a string per row and a file buffer growing by 2000 bytes at a time
+static void workloadRealloc(result_t *result)
+{
+	for (int round = 0; round < 4; round++)
+	{
+		void **rows = NULL;
+		char *buffer = kmalloc(2001);
+		size_t ops = 1;
+
+		startBatch();
+		for (size_t off = 2000; off < 64000; off += 2000)
+		{
+			buffer = krealloc(buffer, 2001 + off);
+			ops++;
+		}
+
+		for (size_t row = 0; row < 1000; row++)
+		{
+			rows = krealloc(rows, sizeof(void*) * (row + 1));
+			rows[row] = kmalloc(20 + rng() % 60);
+			ops += 2;
+		}
+
+		for (size_t row = 0; row < 1000; row++)
+			kfree(rows[row]);
+		kfree(rows);
+		kfree(buffer);
+		endBatch(result, ops + 1002);
+	}
+}
+
+// Short lived strings like the paths of the VFS
+static void workloadStrings(result_t *result)
+{
+	static const char *paths[] = { "/", "/bin", "/bin/ls.elf", "/libc.so", "/home/user/some/deeper/path/file.txt" };
+
+	for (int batch = 0; batch < 50; batch++)
+	{
+		startBatch();
+		for (int i = 0; i < SAMPLE_INTERVAL; i++)
+		{
+			size_t slot = rng() % 64;
+
+			if (slots[slot])
+				kfree(slots[slot]);
+
+			slots[slot] = kstrdup(paths[rng() % 5]);
+		}
+		endBatch(result, SAMPLE_INTERVAL);
+	}
+
+	freeSlots(result);
+}
+
+// Finds the slot of a recorded pointer
+static trace_slot_t* traceSlot(uint32_t key, bool insert)
+{
+	size_t index = (key * 2654435761U) % TRACE_SLOTS;
+
+	for (size_t probe = 0; probe < TRACE_SLOTS; probe++)
+	{
+		trace_slot_t *slot = &traceSlots[(index + probe) % TRACE_SLOTS];
+
+		if (slot->key == key)
+			return slot;
+
+		if (slot->key == 0 && insert)
+		{
+			slot->key = key;
+			return slot;
+		}
+
+		if (slot->key == 0)
+			return NULL;
+	}
+
+	return NULL;
+}
+
+// Removes a recorded pointer. Following entries get reinserted to keep probing intact
+static void traceRemove(trace_slot_t *slot)
+{
+	size_t index = slot - traceSlots;
+	slot->key = 0;
+
+	for (size_t next = (index + 1) % TRACE_SLOTS; traceSlots[next].key; next = (next + 1) % TRACE_SLOTS)
+	{
+		trace_slot_t moved = traceSlots[next];
+		traceSlots[next].key = 0;
+		traceSlot(moved.key, true)->value = moved.value;
+	}
+}
+
+// Replays the [HEAPTRACE] lines of a recorded debug log
+static void workloadTrace(result_t *result)
+{
+	FILE *file = fopen(tracePath, "r");
+	if (!file)
+	{
+		perror(tracePath);
+		exit(1);
+	}
+
+	char line[512];
+	size_t ops = 0;
+
+	startBatch();
+	while (fgets(line, sizeof(line), file))
+	{
+		char *entry = strstr(line, "[HEAPTRACE]");
+		if (!entry)
+			continue;
+
+		char op;
+		unsigned int ptr, size, old;
+		if (sscanf(entry, "[HEAPTRACE] %c %x %u %x", &op, &ptr, &size, &old) != 4)
+			continue;
+
+		trace_slot_t *slot;
+		void *replayed = NULL;
+
+		switch (op)
+		{
+			case HEAP_TRACE_ALLOC:
+			case HEAP_TRACE_ZALLOC:
+				replayed = op == HEAP_TRACE_ALLOC ? kmalloc(size) : kzalloc(size);
+				if (ptr)
+					traceSlot(ptr, true)->value = replayed;
+				break;
+			case HEAP_TRACE_REALLOC:
+				if (old && (slot = traceSlot(old, false)))
+				{
+					replayed = slot->value;
+					traceRemove(slot);
+				}
+				replayed = krealloc(replayed, size);
+				if (ptr)
+					traceSlot(ptr, true)->value = replayed;
+				break;
+			case HEAP_TRACE_FREE:
+				if ((slot = traceSlot(ptr, false)))
+				{
+					kfree(slot->value);
+					traceRemove(slot);
+				}
+				break;
+			default:
+				continue;
+		}
+
+		if (++ops % SAMPLE_INTERVAL == 0)
+		{
+			endBatch(result, SAMPLE_INTERVAL);
+			startBatch();
+		}
+	}
+	endBatch(result, ops % SAMPLE_INTERVAL);
+
+	fclose(file);
+}
+
+// Runs a workload in a child process so every workload starts with a fresh heap
+static void run(const char *name, workload_t workload)
+{
+	fflush(stdout);
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		perror("fork");
+		exit(1);
+	}
+
+	if (pid > 0)
+	{
+		int status;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			printf("%-10s failed\n", name);
+		return;
+	}
+
+	if (mockInitMemory())
+		exit(1);
+
+	pmm_stats_t pmmBase;
+	pmmGetStats(&pmmBase);
+
+	result_t result = { 0 };
+	workload(&result);
+
+	heap_stats_t heap;
+	pmm_stats_t pmm;
+	heapGetStats(&heap);
+	pmmGetStats(&pmm);
+
+	printf("%-10s %9zu %9.1f %12zu %12zu %7u%% %7u%% %10zu %10zu\n",
+		name,
+		result.ops,
+		result.ops ? (double)result.nanoseconds / result.ops : 0.0,
+		heap.peakBytes,
+		(pmm.peakUsedBlocks - pmmBase.usedBlocks) * PMM_BLOCK_SIZE,
+		result.fragmentationMax,
+		result.fragmentationEnd,
+		heap.reallocCopied,
+		heap.reallocSaved);
+
+	exit(0);
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Usage: heapbench [-v] [trace.log]
+// Without a trace all synthetic workloads are run
+int main(int argc, char *argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-v") == 0)
+			toggle_debug_output(true);
+		else
+			tracePath = argv[i];
+	}
+
+	printf("%-10s %9s %9s %12s %12s %8s %8s %10s %10s\n",
+		"workload", "ops", "ns/op", "peak live", "peak pages", "frag max", "frag end", "re copied", "re saved");
+
+	if (tracePath)
+	{
+		run("trace", workloadTrace);
+		return 0;
+	}
+
+	run("fifo", workloadFifo);
+	run("lifo", workloadLifo);
+	run("random", workloadRandom);
+	run("realloc", workloadRealloc);
+	run("strings", workloadStrings);
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include "mock.h"
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <memory/pmm.h>
+#include <multiboot.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+static bool verbose = false;
+
+//------------------------------------------------------------------------------------------
+//				debug.h replacement
+//------------------------------------------------------------------------------------------
+
+void toggle_debug_output(bool on)
+{
+	verbose = on;
+}
+
+void debug_set_color(char foreground, char background)
+{
+	(void)foreground;
+	(void)background;
+}
+
+int debug_print(const char *s)
+{
+	if (verbose)
+		fprintf(stderr, "[DEBUG]: %s\n", s);
+
+	return 0;
+}
+
+int debug_printf(const char *format, ...)
+{
+	if (!verbose)
+		return 0;
+
+	va_list ap;
+	va_start(ap, format);
+	fprintf(stderr, "[DEBUG]: ");
+	int written = vfprintf(stderr, format, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+
+	return written;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Maps the fake physical memory and initializes the PMM with a memory map
+// describing it. The kernel image (_start to _end) is placed at its beginning
+// by the linker flags, the PMM bitmaps follow directly after it
+int mockInitMemory()
+{
+	// Never replace existing mappings, the pool address is only a request
+	void *pool = mmap((void*)MOCK_POOL_BASE, MOCK_POOL_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (pool != (void*)MOCK_POOL_BASE)
+	{
+		fprintf(stderr, "Could not map the memory pool at %#lx: %s\n", (unsigned long)MOCK_POOL_BASE, strerror(errno));
+		return -1;
+	}
+
+	// The memory map has to lie below 4GiB, so it lives in the last block of the pool.
+	// The PMM frees one block more than a region spans, so keep a gap to it
+	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t*)(MOCK_POOL_BASE + MOCK_POOL_SIZE - PMM_BLOCK_SIZE);
+	mmap[0].size = sizeof(multiboot_mmap_entry_t) - sizeof(mmap[0].size);
+	mmap[0].addr = 0;
+	mmap[0].len = MOCK_POOL_BASE;
+	mmap[0].type = 2; // Reserved
+	mmap[1].size = sizeof(multiboot_mmap_entry_t) - sizeof(mmap[1].size);
+	mmap[1].addr = MOCK_POOL_BASE;
+	mmap[1].len = MOCK_POOL_SIZE - 2 * PMM_BLOCK_SIZE;
+	mmap[1].type = 1; // Available
+
+	multiboot_info_t header;
+	memset(&header, 0, sizeof(header));
+	header.flags = 0x41; // Memory size and memory map available
+	header.memory_hi = (MOCK_POOL_BASE + MOCK_POOL_SIZE) / 1024 - 1024;
+	header.mmap_addr = (uint32_t)(uintptr_t)mmap;
+	header.mmap_len = 2 * sizeof(multiboot_mmap_entry_t);
+
+	return initPMM(&header);
+}
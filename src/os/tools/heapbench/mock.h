@@ -0,0 +1,21 @@
+#ifndef _HEAPBENCH_MOCK_H
+#define _HEAPBENCH_MOCK_H
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+// Fake physical memory handed to the PMM. The base is set by the Makefile,
+// which also places the _start/_end symbols there
+#ifndef MOCK_POOL_BASE
+#define MOCK_POOL_BASE 0x40000000UL
+#endif
+#define MOCK_POOL_SIZE (64UL * 1024 * 1024)
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+int mockInitMemory();
+
+#endif // _HEAPBENCH_MOCK_H
@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <ld-owos/ld-owos.h>
+#include <debug.h>
+
+#include "dynamic-linker.h"
+#include "mock.h"
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+#define RUNS 32 // Cold, warm and static launches of every program
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+// Hands the libraries back like linker_main does when the program exits
+static void releaseLibs()
+{
+	for (size_t i = loaded_lib_count - 1; i != (size_t)-1; i--)
+	{
+		if (loaded_libs[i]->resident)
+			dynamic_linker_release_lib(loaded_libs[i]);
+		else
+			linker_free_lib(loaded_libs[i]);
+	}
+	loaded_lib_count = 0;
+}
+
+// Starts the program like the shell does, up to its entry point
+// Returns the error of linker_main if it couldn't be started
+static int launch(const char *name)
+{
+	char path[FILENAME_MAX + 1];
+	snprintf(path, sizeof(path), "/bin/%s.elf", name);
+
+	char *args[] = { path, NULL };
+
+	FILE *executable = vfsOpen(path, "r");
+	if (!executable)
+		return -1;
+
+	// linker_main only returns if the program couldn't be started
+	if (__builtin_setjmp(mockProgramEntry) == 0)
+		return linker_main(NULL, NULL, NULL, executable, 1, args);
+
+	releaseLibs();
+	return 0;
+}
+
+// Prints the average of the launches since the counters were saved, in microseconds with one decimal
+static void printAverage(uint32_t ticks, size_t launches)
+{
+	if (!launches)
+	{
+		mockPrintf(" %11s", "-");
+		return;
+	}
+
+	uint32_t tenths = ticks * 10 / launches;
+	mockPrintf(" %9u.%u", tenths / 10, tenths % 10);
+}
+
+// Launches the program with and without its cached image,
+// and the variant linked without the dynamic linker if `make static` built it
+static int run(const char *name)
+{
+	linker_stats_t before, cold, warm, statics;
+	mock_io_t io = mockIO;
+
+	// Every cold launch loads the program again, its libraries stay resident.
+	// Nothing of the program is cached, so all of it comes from the driver
+	linker_get_stats(&before);
+	for (int i = 0; i < RUNS; i++)
+	{
+		dynamic_linker_drop_images();
+		mockDropPages();
+
+		int ret = launch(name);
+		if (ret)
+		{
+			mockPrintf("%s: linker_main failed with %d\n", name, ret);
+			return ret;
+		}
+	}
+	linker_get_stats(&cold);
+
+	size_t vfsCalls = mockIO.vfsCalls - io.vfsCalls;
+	size_t driverCalls = mockIO.driverCalls - io.driverCalls;
+
+	// The last cold launch left the image in the cache
+	for (int i = 0; i < RUNS; i++)
+		launch(name);
+	linker_get_stats(&warm);
+
+	// Static executables are never cached, every launch reads the file again
+	char staticName[FILENAME_MAX + 1];
+	snprintf(staticName, sizeof(staticName), "%s-static", name);
+
+	for (int i = 0; i < RUNS; i++)
+	{
+		mockDropPages();
+
+		int ret = launch(staticName);
+		if (ret == -1) // Not built
+			break;
+		if (ret)
+		{
+			mockPrintf("%s: linker_main failed with %d\n", staticName, ret);
+			return ret;
+		}
+	}
+	linker_get_stats(&statics);
+
+	uint32_t coldTicks = cold.cold_ticks - before.cold_ticks;
+	size_t coldLaunches = cold.cold_launches - before.cold_launches;
+	uint32_t warmTicks = warm.warm_ticks - cold.warm_ticks;
+	size_t warmLaunches = warm.warm_launches - cold.warm_launches;
+	uint32_t staticTicks = statics.static_ticks - warm.static_ticks;
+	size_t staticLaunches = statics.static_launches - warm.static_launches;
+
+	mockPrintf("%-10s", name);
+	printAverage(coldTicks, coldLaunches);
+	printAverage(warmTicks, warmLaunches);
+	printAverage(staticTicks, staticLaunches);
+	mockPrintf(" %9u %9u\n", vfsCalls / RUNS, driverCalls / RUNS);
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Usage: ldbench [-v] <os build dir> [program...]
+// Launches ls, cat and editor if no programs are given
+int main(int argc, char *argv[])
+{
+	const char *programs[16];
+	size_t programCount = 0;
+	const char *root = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-v") == 0)
+			toggle_debug_output(true);
+		else if (!root)
+			root = argv[i];
+		else if (programCount < sizeof(programs) / sizeof(programs[0]))
+			programs[programCount++] = argv[i];
+	}
+
+	if (!root)
+	{
+		mockPrintf("Usage: ldbench [-v] <os build dir> [program...]\n");
+		return 1;
+	}
+
+	if (programCount == 0)
+	{
+		programs[programCount++] = "ls";
+		programs[programCount++] = "cat";
+		programs[programCount++] = "editor";
+	}
+
+	if (mockInitMemory())
+		return 1;
+
+	mockSetRoot(root);
+
+	// The first launch also loads the shared libraries, which stay resident afterwards
+	linker_stats_t first;
+	int ret = launch(programs[0]);
+	if (ret)
+	{
+		mockPrintf("%s: could not be started from %s (%d)\n", programs[0], root, ret);
+		return 1;
+	}
+	linker_get_stats(&first);
+	mockPrintf("First launch including the libraries: %u us\n\n", first.cold_ticks);
+
+	// The calls are counted per cold launch
+	mockPrintf("%-10s %11s %11s %11s %9s %9s\n", "program", "cold us", "warm us", "static us", "vfs", "driver");
+
+	for (size_t i = 0; i < programCount; i++)
+	{
+		if (run(programs[i]))
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,434 @@
+#include "mock.h"
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <memory/pmm.h>
+#include <memory/heap.h>
+#include <memory/arena.h>
+#include <vfs/vfs.h>
+#include <vfs/pagecache.h>
+#include <multiboot.h>
+#include <debug.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+// i386 Linux system calls, there is no C library to do them
+#define SYS_EXIT_GROUP    252
+#define SYS_READ          3
+#define SYS_WRITE         4
+#define SYS_OPEN          5
+#define SYS_CLOSE         6
+#define SYS_LSEEK         19
+#define SYS_MMAP          90
+#define SYS_CLOCK_GETTIME 265
+
+#define HOST_PROT_READ      0x1
+#define HOST_PROT_WRITE     0x2
+#define HOST_MAP_PRIVATE    0x02
+#define HOST_MAP_ANONYMOUS  0x20
+#define HOST_MAP_NORESERVE  0x4000
+#define HOST_MAP_FIXED_NOREPLACE 0x100000
+#define HOST_CLOCK_MONOTONIC 1
+
+#define HOST_STDOUT 1
+#define HOST_STDERR 2
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// File of the build directory, read once and served from memory afterwards
+typedef struct mock_file_t
+{
+	file_desc_t desc;
+	char *data;
+} mock_file_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+void *mockProgramEntry[5];
+mock_io_t mockIO;
+
+// Replaces the one of arena.c, the programs never get to allocate
+arena_t *currentArena = NULL;
+
+static bool verbose = false;
+
+static const char *root = ".";
+static mountpoint_t mount; // Only the address is used, to key the cached pages
+static mock_file_t files[MOCK_MAX_FILES];
+static size_t fileCount = 0;
+
+//------------------------------------------------------------------------------------------
+//				Program entry
+//------------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[]);
+
+// Aligns the stack and passes the arguments the kernel put on it to main
+__asm__(
+	".text\n"
+	".global mock_entry\n"
+	"mock_entry:\n"
+	"	xorl %ebp, %ebp\n"
+	"	movl (%esp), %eax\n"	// argc
+	"	leal 4(%esp), %edx\n"	// argv
+	"	andl $-16, %esp\n"
+	"	subl $8, %esp\n"
+	"	pushl %edx\n"
+	"	pushl %eax\n"
+	"	call main\n"
+	"	pushl %eax\n"
+	"	call mockExit\n"
+);
+
+//------------------------------------------------------------------------------------------
+//				Private function implementations
+//------------------------------------------------------------------------------------------
+
+// Returns the part of the path behind the last slash
+static const char *baseName(const char *path)
+{
+	const char *name = path;
+	for (; *path; path++)
+	{
+		if (*path == '/')
+			name = path + 1;
+	}
+	return name;
+}
+
+static int hostCall(int number, int a, int b, int c)
+{
+	int ret;
+	__asm__ volatile("int $0x80" : "=a"(ret) : "a"(number), "b"(a), "c"(b), "d"(c) : "memory");
+	return ret;
+}
+
+static void hostWrite(int fd, const char *s, size_t size)
+{
+	hostCall(SYS_WRITE, fd, (int)s, (int)size);
+}
+
+static int hostPrint(int fd, const char *format, va_list ap)
+{
+	char buffer[512];
+	int written = vsnprintf(buffer, sizeof(buffer), format, ap);
+
+	hostWrite(fd, buffer, strlen(buffer));
+	return written;
+}
+
+// Copies file data like the disk would
+static size_t copyData(mock_file_t *file, size_t offset, size_t size, char *buf)
+{
+	if (offset >= file->desc.length)
+		return 0;
+	if (size > file->desc.length - offset)
+		size = file->desc.length - offset;
+
+	memcpy(buf, file->data + offset, size);
+	return size;
+}
+
+// Driver of the files, counts the calls the page cache makes
+static size_t driverRead(file_desc_t *node, size_t offset, size_t size, char *buf)
+{
+	mockIO.driverCalls++;
+	return copyData((mock_file_t*)node, offset, size, buf);
+}
+
+// One call like a vectored read of the FAT32 driver
+static size_t driverReadv(file_desc_t *node, size_t offset, const struct iovec *iov, int iovcnt)
+{
+	size_t done = 0;
+	mockIO.driverCalls++;
+
+	for (int i = 0; i < iovcnt; i++)
+	{
+		size_t amount = copyData((mock_file_t*)node, offset + done, iov[i].iov_len, iov[i].iov_base);
+		done += amount;
+
+		if (amount < iov[i].iov_len)
+			break;
+	}
+
+	return done;
+}
+
+// Reads the file of the build directory the OwOS path stands for.
+// Programs live in a folder of their own: /bin/ls.elf is <root>/ls/ls.elf, /bin/ls-static.elf is <root>/ls/ls-static.elf
+static mock_file_t *loadFile(const char *path)
+{
+	char hostPath[512];
+	const char *name = baseName(path);
+
+	if (fileCount == MOCK_MAX_FILES || strlen(name) > FILENAME_MAX)
+		return NULL;
+
+	if (strncmp(path, "/bin/", 5) == 0)
+	{
+		char stem[FILENAME_MAX + 1];
+		strcpy(stem, name);
+		if (strstr(stem, ".elf"))
+			*strstr(stem, ".elf") = 0;
+
+		// The static variants are built next to them
+		if (strstr(stem, "-static"))
+			*strstr(stem, "-static") = 0;
+
+		snprintf(hostPath, sizeof(hostPath), "%s/%s/%s", root, stem, name);
+	}
+	else
+		snprintf(hostPath, sizeof(hostPath), "%s%s", root, path);
+
+	int fd = hostCall(SYS_OPEN, (int)hostPath, 0, 0);
+	if (fd < 0)
+		return NULL;
+
+	int length = hostCall(SYS_LSEEK, fd, 0, SEEK_END);
+	hostCall(SYS_LSEEK, fd, 0, SEEK_SET);
+
+	char *data = length > 0 ? kmalloc(length) : NULL;
+	int done = 0;
+	while (data && done < length)
+	{
+		int amount = hostCall(SYS_READ, fd, (int)(data + done), length - done);
+		if (amount <= 0)
+			break;
+		done += amount;
+	}
+
+	hostCall(SYS_CLOSE, fd, 0, 0);
+
+	if (!data || done < length)
+	{
+		kfree(data);
+		return NULL;
+	}
+
+	mock_file_t *file = &files[fileCount++];
+	strcpy(file->desc.name, name);
+	file->desc.length = length;
+	file->desc.inode = fileCount;
+	file->desc.flags = FS_FILE;
+	file->desc.mount = &mount;
+	file->desc.read = driverRead;
+	file->desc.readv = driverReadv;
+	file->data = data;
+
+	if (verbose)
+		mockPrintf("Loaded %s from %s (%u bytes)\n", path, hostPath, length);
+
+	return file;
+}
+
+//------------------------------------------------------------------------------------------
+//				debug.h, hal and arena.h replacements
+//------------------------------------------------------------------------------------------
+
+void toggle_debug_output(bool on)
+{
+	verbose = on;
+}
+
+void debug_set_color(char foreground, char background)
+{
+	(void)foreground;
+	(void)background;
+}
+
+int debug_print(const char *s)
+{
+	return debug_printf("%s", s);
+}
+
+int debug_printf(const char *format, ...)
+{
+	if (!verbose)
+		return 0;
+
+	va_list ap;
+	va_start(ap, format);
+	hostWrite(HOST_STDERR, "[DEBUG]: ", 9);
+	int written = hostPrint(HOST_STDERR, format, ap);
+	hostWrite(HOST_STDERR, "\n", 1);
+	va_end(ap);
+
+	return written;
+}
+
+// Microseconds instead of the milliseconds of the PIT, the launches are too fast for them
+uint32_t getTicks(void)
+{
+	struct { int32_t seconds; int32_t nanoseconds; } now;
+	hostCall(SYS_CLOCK_GETTIME, HOST_CLOCK_MONOTONIC, (int)&now, 0);
+
+	return (uint32_t)now.seconds * 1000000 + (uint32_t)now.nanoseconds / 1000;
+}
+
+void halt(void)
+{
+	hostWrite(HOST_STDERR, "halt() called\n", 14);
+	mockExit(1);
+}
+
+// linker_main creates the arena of the program right before it jumps to the entry point.
+// The programs can't run here, so the launch ends at this point
+arena_t* arenaCreate()
+{
+	__builtin_longjmp(mockProgramEntry, 1);
+}
+
+void arenaDestroy(arena_t *arena)
+{
+	(void)arena;
+}
+
+//------------------------------------------------------------------------------------------
+//				vfs.h replacement
+//------------------------------------------------------------------------------------------
+
+FILE *vfsOpen(const char *path, const char *mode)
+{
+	(void)mode;
+
+	mock_file_t *file = NULL;
+	for (size_t i = 0; i < fileCount && !file; i++)
+	{
+		if (strcmp(files[i].desc.name, baseName(path)) == 0)
+			file = &files[i];
+	}
+
+	if (!file && !(file = loadFile(path)))
+		return NULL;
+
+	FILE *stream = kzalloc(sizeof(FILE));
+	stream->file_desc = &file->desc;
+	return stream;
+}
+
+void vfsClose(FILE *file)
+{
+	kfree(file);
+}
+
+// Reads go through the page cache straight to the driver, like reads larger than the stream buffer
+size_t vfsRead(FILE *file, void *buf, size_t size)
+{
+	mockIO.vfsCalls++;
+
+	size_t amount = pagecacheRead(file->file_desc, file->pos, size, buf);
+	file->pos += amount;
+
+	return amount;
+}
+
+size_t vfsReadv(FILE *file, const struct iovec *iov, int iovcnt)
+{
+	mockIO.vfsCalls++;
+
+	size_t amount = pagecacheReadv(file->file_desc, file->pos, iov, iovcnt);
+	file->pos += amount;
+
+	return amount;
+}
+
+int vfsSeek(FILE *file, long offset, int origin)
+{
+	mockIO.vfsCalls++;
+
+	if (origin == SEEK_CUR)
+		file->pos += offset;
+	else if (origin == SEEK_END)
+		file->pos = file->file_desc->length + offset;
+	else
+		file->pos = offset;
+
+	return 0;
+}
+
+int vfsFlush(FILE *file)
+{
+	(void)file;
+	return 0;
+}
+
+//------------------------------------------------------------------------------------------
+//				Public function implementations
+//------------------------------------------------------------------------------------------
+
+// Maps the fake physical memory and initializes the PMM with a memory map
+// describing it. The kernel image (_start to _end) is placed at its beginning
+// by the linker flags, the PMM bitmaps follow directly after it
+int mockInitMemory()
+{
+	// Never replace existing mappings, the pool address is only a request
+	uint32_t args[6] = { MOCK_POOL_BASE, MOCK_POOL_SIZE, HOST_PROT_READ | HOST_PROT_WRITE,
+		HOST_MAP_PRIVATE | HOST_MAP_ANONYMOUS | HOST_MAP_NORESERVE | HOST_MAP_FIXED_NOREPLACE, (uint32_t)-1, 0 };
+
+	if ((uint32_t)hostCall(SYS_MMAP, (int)args, 0, 0) != MOCK_POOL_BASE)
+	{
+		mockPrintf("Could not map the memory pool at 0x%x\n", MOCK_POOL_BASE);
+		return -1;
+	}
+
+	// The PMM frees one block more than a region spans, so keep a gap to the memory map
+	multiboot_mmap_entry_t *mmap = (multiboot_mmap_entry_t*)(MOCK_POOL_BASE + MOCK_POOL_SIZE - PMM_BLOCK_SIZE);
+	mmap[0].size = sizeof(multiboot_mmap_entry_t) - sizeof(mmap[0].size);
+	mmap[0].addr = 0;
+	mmap[0].len = MOCK_POOL_BASE;
+	mmap[0].type = 2; // Reserved
+	mmap[1].size = sizeof(multiboot_mmap_entry_t) - sizeof(mmap[1].size);
+	mmap[1].addr = MOCK_POOL_BASE;
+	mmap[1].len = MOCK_POOL_SIZE - 2 * PMM_BLOCK_SIZE;
+	mmap[1].type = 1; // Available
+
+	multiboot_info_t header;
+	memset(&header, 0, sizeof(header));
+	header.flags = 0x41; // Memory size and memory map available
+	header.memory_hi = (MOCK_POOL_BASE + MOCK_POOL_SIZE) / 1024 - 1024;
+	header.mmap_addr = (uint32_t)mmap;
+	header.mmap_len = 2 * sizeof(multiboot_mmap_entry_t);
+
+	return initPMM(&header);
+}
+
+// Empties the page cache, so the next launch reads the files from the driver again
+void mockDropPages()
+{
+	for (size_t i = 0; i < fileCount; i++)
+		pagecacheInvalidate(&files[i].desc);
+}
+
+// Sets the build directory the files are read from
+void mockSetRoot(const char *dir)
+{
+	root = dir;
+}
+
+int mockPrintf(const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	int written = hostPrint(HOST_STDOUT, format, ap);
+	va_end(ap);
+
+	return written;
+}
+
+_Noreturn void mockExit(int code)
+{
+	for (;;)
+		hostCall(SYS_EXIT_GROUP, code, 0, 0);
+}
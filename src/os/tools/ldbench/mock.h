@@ -0,0 +1,56 @@
+#ifndef _LDBENCH_MOCK_H
+#define _LDBENCH_MOCK_H
+
+//------------------------------------------------------------------------------------------
+//				Includes
+//------------------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------------------
+//				Constants
+//------------------------------------------------------------------------------------------
+
+// Fake physical memory handed to the PMM. The base is set by the Makefile,
+// which also places the _start/_end symbols there. It ends behind the region
+// static executables are linked for, so they run at their real addresses
+#ifndef MOCK_POOL_BASE
+#define MOCK_POOL_BASE 0x00100000UL
+#endif
+#define MOCK_POOL_SIZE (0x02000000UL - MOCK_POOL_BASE)
+
+#define MOCK_MAX_FILES 32 // Programs and libraries the VFS replacement keeps in memory
+
+//------------------------------------------------------------------------------------------
+//				Types
+//------------------------------------------------------------------------------------------
+
+// File accesses of the launches
+typedef struct mock_io_t
+{
+	size_t vfsCalls;    // Reads and seeks of the loader
+	size_t driverCalls; // Reads the page cache handed to the driver
+} mock_io_t;
+
+//------------------------------------------------------------------------------------------
+//				Variables
+//------------------------------------------------------------------------------------------
+
+// Jumped to instead of running the program, set with __builtin_setjmp before linker_main
+extern void *mockProgramEntry[5];
+
+extern mock_io_t mockIO;
+
+//------------------------------------------------------------------------------------------
+//				Public Function
+//------------------------------------------------------------------------------------------
+
+int mockInitMemory();
+void mockSetRoot(const char *dir);
+void mockDropPages();
+
+int mockPrintf(const char *format, ...);
+_Noreturn void mockExit(int code);
+
+#endif // _LDBENCH_MOCK_H